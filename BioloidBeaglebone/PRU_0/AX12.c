@@ -7,7 +7,8 @@
  *  creating packets from those structures to be written out to the serial bus.
  *
  *  @author Bill Merryman
- *  @bug There is a bug in AX12SetSyncInfoAll when the buffer array is sized dynamically, at
+ *  @bug There is a bug in AX12SetSyncInfoSlots (which AX12SetSyncInfoAll sends through)
+ *  when the buffer array is sized dynamically, at
  *  run time. Might be a result of being sized with an int. Currently coping with this by
  *  setting the buffer statically to 256, which is as big as it can possibly be. The issue
  *  just causes the executable to be too big, so not really a bug, just prevents compiling
@@ -310,12 +311,22 @@ void AX12SetSyncInfo(byte txParameters[], int txParametersLength)
 }
 
 void AX12SetSyncInfoAll(byte startPosition, byte endPosition)
+{
+
+	byte slots[AX12_NUM_ATTACHED];
+	for(int slot = 0; slot < AX12Count; slot++) slots[slot] = slot;
+
+	AX12SetSyncInfoSlots(slots, AX12Count, startPosition, endPosition);
+
+}
+
+void AX12SetSyncInfoSlots(byte slots[], int slotCount, byte startPosition, byte endPosition)
 {
 
 	int positionCount = (endPosition - startPosition) + 1;
 	int frameSize = DYNAMIXEL_ID_WIDTH + positionCount;
 	//calculate size of array
-	int txParametersLength = DYNAMIXEL_SYNC_STARTING_ADDRESS_WIDTH + DYNAMIXEL_SYNC_LENGTH_OF_DATA_WIDTH + (AX12Count * frameSize);
+	int txParametersLength = DYNAMIXEL_SYNC_STARTING_ADDRESS_WIDTH + DYNAMIXEL_SYNC_LENGTH_OF_DATA_WIDTH + (slotCount * frameSize);
 	//PRU doesn't like dynamic array allocations in functions, it imports
 	//an insane amount of code to cope with it, and blows past the
 	//image size of the PRU discovered 02/11/15
@@ -324,9 +335,9 @@ void AX12SetSyncInfoAll(byte startPosition, byte endPosition)
 	//populate
 	txParameters[DYNAMIXEL_SYNC_STARTING_ADDRESS_POSITION] = startPosition;
 	txParameters[DYNAMIXEL_SYNC_LENGTH_OF_DATA_POSITION] = positionCount;
-	for(int slot = 0; slot < AX12Count; slot++){
-		txParameters[DYNAMIXEL_SYNC_STARTING_ADDRESS_WIDTH + DYNAMIXEL_SYNC_LENGTH_OF_DATA_WIDTH + (slot * frameSize)] = AX12s[slot].ID;
-		memcpy((void *)(txParameters + (DYNAMIXEL_SYNC_STARTING_ADDRESS_WIDTH + DYNAMIXEL_SYNC_LENGTH_OF_DATA_WIDTH) + (slot * frameSize) + DYNAMIXEL_ID_WIDTH), (void *)((byte *)&(AX12s[slot].torqueEnable)) + (startPosition - AX12_TORQUE_ENABLE), positionCount);
+	for(int i = 0; i < slotCount; i++){
+		txParameters[DYNAMIXEL_SYNC_STARTING_ADDRESS_WIDTH + DYNAMIXEL_SYNC_LENGTH_OF_DATA_WIDTH + (i * frameSize)] = AX12s[slots[i]].ID;
+		memcpy((void *)(txParameters + (DYNAMIXEL_SYNC_STARTING_ADDRESS_WIDTH + DYNAMIXEL_SYNC_LENGTH_OF_DATA_WIDTH) + (i * frameSize) + DYNAMIXEL_ID_WIDTH), (void *)((byte *)&(AX12s[slots[i]].torqueEnable)) + (startPosition - AX12_TORQUE_ENABLE), positionCount);
 	}
 
 	AX12SetSyncInfo(txParameters, txParametersLength);
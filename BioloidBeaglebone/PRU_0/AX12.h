@@ -511,4 +511,20 @@ void AX12SetSyncInfo(byte txParameters[], int txParametersLength);
  */
 void AX12SetSyncInfoAll(byte startPosition, byte endPosition);
 
+/** @brief Build a sync-write packet to be sent out to some of the attached devices.
+ *
+ * 	This function works as AX12SetSyncInfoAll does, but only includes child packets for
+ * 	the given devices, so that streaming a few joints doesn't cost a packet the size of
+ * 	the whole body.
+ *
+ *	@param	byte[]		The positions in the array of AX-12s structures of the devices to
+ *						include.
+ *	@param	int			The number of devices to include.
+ *	@param	byte		The start position in the AX-12 data table of values.
+ *	@param	byte		The end position in the AX-12 data table of values.
+ * 	@return void
+ *
+ */
+void AX12SetSyncInfoSlots(byte slots[], int slotCount, byte startPosition, byte endPosition);
+
 #endif /* AX12_H_ */
@@ -49,3 +49,15 @@ uint8_t* PRUInterop0GetMotionArgument(void)
 	PRU_INTEROP_0_DATA *PRUInterop0Data = (PRU_INTEROP_0_DATA *)resourceTable.carveout.pa;
 	return &(PRUInterop0Data->motionArgument);
 }
+
+JOINT_SETPOINTS* PRUInterop0GetJointSetpoints(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_0_DATA *PRUInterop0Data = (PRU_INTEROP_0_DATA *)resourceTable.carveout.pa;
+	return &(PRUInterop0Data->jointSetpoints);
+}
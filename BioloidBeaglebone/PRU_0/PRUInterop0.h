@@ -13,6 +13,23 @@
 #include "protocol.h"
 
 #define MAX_MOTION_PAGES					128
+#define MAX_JOINT_SETPOINTS					4
+
+/*
+ * Joint goals streamed by the host (the look-at controller, for instance), applied as
+ * soon as they arrive rather than on the next motion clock tick, without going through
+ * page playback. The host makes the sequence odd while it writes and even when it is
+ * done, so a block read with the same even sequence before and after is consistent.
+ * Every member is a multiple of 4 bytes in size so the PRU compiler, which packs on
+ * byte boundaries, and the ARM compiler lay the block out the same way.
+ */
+typedef struct{
+	volatile uint32_t sequence;
+	uint32_t count;
+	uint16_t goalPositions[MAX_JOINT_SETPOINTS];
+	uint16_t movingSpeeds[MAX_JOINT_SETPOINTS];
+	uint8_t IDs[MAX_JOINT_SETPOINTS];
+} JOINT_SETPOINTS;
 
 /*
  *  Here we are going to take out the motionInstruction and motionArgument members, and
@@ -25,6 +42,8 @@ typedef struct{
 	//To be taken out...
 	uint8_t motionInstruction;
 	uint8_t motionArgument;
+	uint8_t reserved[2];
+	JOINT_SETPOINTS jointSetpoints;
 	/*To be added...
 	volatile uint8_t RxReadPosition = 0;
 	volatile uint8_t RxWritePosition = 0;
@@ -38,5 +57,6 @@ typedef struct{
 MOTION_PAGE* PRUInterop0GetMotionPages(void);
 uint8_t* PRUInterop0GetMotionInstruction(void);
 uint8_t* PRUInterop0GetMotionArgument(void);
+JOINT_SETPOINTS* PRUInterop0GetJointSetpoints(void);
 
 #endif /* PRUINTEROP0_H_ */
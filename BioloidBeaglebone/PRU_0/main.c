@@ -37,5 +37,6 @@ void main(){
 			//AXS1GetInfoAll(AXS1_LEFT_IR_SENSOR_DATA, AXS1_RIGHT_IR_SENSOR_DATA);
 		}
 		motionProcessInstruction();
+		motionProcessSetpoints();
 	}
 }
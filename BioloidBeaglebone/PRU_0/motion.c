@@ -21,6 +21,8 @@
 MOTION_PAGE *motionPages;
 volatile uint8_t *motionInstruction;
 volatile uint8_t *motionArgument;
+volatile JOINT_SETPOINTS *jointSetpoints;
+uint32_t jointSetpointsSequence = 0;
 
 MOTION_PAGE currentPage;
 MOTION_PAGE nextPage;
@@ -40,6 +42,8 @@ void motionInitialize(void)
 	motionPages = PRUInterop0GetMotionPages();
 	motionInstruction = PRUInterop0GetMotionInstruction();
 	motionArgument = PRUInterop0GetMotionArgument();
+	jointSetpoints = PRUInterop0GetJointSetpoints();
+	jointSetpointsSequence = jointSetpoints->sequence;
 	*motionInstruction = INST_NO_INST;
 	*motionArgument = 0;
 
@@ -69,6 +73,47 @@ void motionProcessInstruction()
 
 }
 
+/*
+ * Applies the host's joint goals as soon as a new, completely written set shows up.
+ * While a page is playing it owns every joint, so the set is left alone until it stops
+ * (by then there will usually be a newer one anyway).
+ */
+void motionProcessSetpoints(void)
+{
+	byte slots[MAX_JOINT_SETPOINTS];
+	uint16_t goalPositions[MAX_JOINT_SETPOINTS];
+	uint16_t movingSpeeds[MAX_JOINT_SETPOINTS];
+	byte IDs[MAX_JOINT_SETPOINTS];
+	int slotCount = 0;
+
+	uint32_t sequence = jointSetpoints->sequence;
+	if(sequence == jointSetpointsSequence || (sequence & 1) || scenePlaying) return;
+
+	uint32_t count = jointSetpoints->count;
+	if(count > MAX_JOINT_SETPOINTS) count = MAX_JOINT_SETPOINTS;
+	for(uint32_t i = 0; i < count; i++)
+	{
+		goalPositions[i] = jointSetpoints->goalPositions[i];
+		movingSpeeds[i] = jointSetpoints->movingSpeeds[i];
+		IDs[i] = jointSetpoints->IDs[i];
+	}
+	if(jointSetpoints->sequence != sequence) return;
+	jointSetpointsSequence = sequence;
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		for(byte slot = 0; slot < AX12sGetCount(); slot++)
+		{
+			if(AX12GetID(slot) != IDs[i]) continue;
+			AX12SetGoalPosition(slot, goalPositions[i]);
+			AX12SetMovingSpeed(slot, movingSpeeds[i]);
+			slots[slotCount++] = slot;
+			break;
+		}
+	}
+	if(slotCount > 0) AX12SetSyncInfoSlots(slots, slotCount, AX12_GOAL_POSITION_L, AX12_MOVING_SPEED_H);
+}
+
 bool motionDoPage(byte pageNumber)
 {
 	if(!motionLoadPage(pageNumber, &currentPage)) return FALSE;
@@ -111,6 +111,7 @@ typedef enum{
 
 void motionInitialize(void);
 void motionProcessInstruction(void);
+void motionProcessSetpoints(void);
 bool motionDoPage(byte pageNumber);
 bool motionDoPose(int pageNumber, int poseNumber);
 bool motionLoadPage(byte pageNumber, MOTION_PAGE *page);
@@ -37,3 +37,120 @@ uint32_t *PRUInterop1GetImageReadyFlag(void)
 	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
 	return (&(PRUInterop1Data->imageReadyFlag));
 }
+
+CAPTURE_STATISTICS *PRUInterop1GetCaptureStatistics(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->captureStatistics));
+}
+
+CAPTURE_CONFIGURATION *PRUInterop1GetCaptureConfiguration(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->captureConfiguration));
+}
+
+CAPTURE_CONFIGURATION *PRUInterop1GetFrameConfiguration(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->frameConfiguration));
+}
+
+SEGMENTATION_CONFIGURATION *PRUInterop1GetSegmentationConfiguration(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->segmentationConfiguration));
+}
+
+SEGMENTATION_RESULT *PRUInterop1GetSegmentationResult(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->segmentationResult));
+}
+
+CAPTURE_HEALTH *PRUInterop1GetCaptureHealth(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->captureHealth));
+}
+
+CAPTURE_SENSOR *PRUInterop1GetCaptureSensor(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->captureSensor));
+}
+
+TEST_PATTERN_CONFIGURATION *PRUInterop1GetTestPatternConfiguration(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->testPatternConfiguration));
+}
+
+CAPTURE_GOVERNOR *PRUInterop1GetCaptureGovernor(void)
+{
+	LED_OFF(PIN_NUMBER_FOR_LED_0);
+	if(resourceTable.carveout.pa == 0)
+	{
+		LED_ON(PIN_NUMBER_FOR_LED_0);
+		while(1);
+	}
+	PRU_INTEROP_1_DATA *PRUInterop1Data = (PRU_INTEROP_1_DATA *)resourceTable.carveout.pa;
+	return (&(PRUInterop1Data->captureGovernor));
+}
+
+/*
+ * The handshake is at the start of the PRU subsystem's shared RAM, which is always
+ * there, so unlike the carveout there is nothing to check.
+ */
+volatile PRU_INTEROP_1_HANDSHAKE *PRUInterop1GetHandshake(void)
+{
+	return (volatile PRU_INTEROP_1_HANDSHAKE *)PRU_SHARED_RAM_PRU_ADDRESS;
+}
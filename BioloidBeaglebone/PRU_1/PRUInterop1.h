@@ -14,12 +14,225 @@
 #define IMAGE_READY						0xFFFFFFFF
 #define IMAGE_NOT_READY					0x00000000
 
+/*
+ * PRU1 sets imageReadyFlag in the carveout when a frame is in, as it always has, but
+ * waits for the host to be done with it on frameTaken here, in the PRU subsystem's
+ * shared RAM. PRU1 reads that over its own local bus, so however long the host takes
+ * the wait puts nothing on the L3 interconnect, where polling the carveout flag put a
+ * DDR read every few hundred nanoseconds alongside PRU0's and the ARM's traffic. The
+ * host clears imageReadyFlag and then sets frameTaken; PRU1 clears frameTaken before
+ * it sets imageReadyFlag, so a frame can't be released before it was handed over.
+ * PRU1 also keeps how many frames it waited on the host for and for how long in all,
+ * and times one read of imageReadyFlag a frame, which is what each pass of the old
+ * polling loop cost.
+ */
+#define PRU_SHARED_RAM_PRU_ADDRESS		0x00010000
+#define PRU_SHARED_RAM_HOST_ADDRESS		0x4A310000
+#define PRU_SHARED_RAM_BYTES			0x00003000
+
+typedef struct{
+	uint32_t frameTaken;
+	uint32_t waits;
+	uint64_t waitCycles;
+	uint32_t carveoutReadCycles;
+	uint32_t reserved;
+} PRU_INTEROP_1_HANDSHAKE;
+
+/*
+ * Filled in by PRU1 after each frame, for the host to report on. The bus figures are for
+ * the last frame: how many OCP write transactions the image took and how big each was.
+ * skippedFrames is the running total of frames the capture governor let go by.
+ */
+typedef struct{
+	uint32_t frames;
+	uint32_t busWrites;
+	uint32_t busWriteBytes;
+	uint32_t flushCycles;
+	uint32_t flushOverruns;
+	uint32_t skippedFrames;
+} CAPTURE_STATISTICS;
+
+/*
+ * How well the camera's timing is holding up, written by PRU1 after every frame it
+ * attempts, good or not. The first four are running totals: waits that gave up (PCLK,
+ * HREF or VSYNC never came), frames abandoned part way (PRU1 goes back to wait for the
+ * next VSYNC and the host never sees them), frames torn by VSYNC arriving before the
+ * last row, and lines HREF ended before the sensor's full width had gone by. The rest
+ * describe the last frame, in PRU cycles: the time between this frame's VSYNC and the
+ * last one PRU1 saw (zero if unknown; it spans several frames when the host was slow,
+ * so the minimum seen is the frame period), the rows seen, the spread of HREF periods
+ * and HREF high times, and the PCLK edges counted over a stretch of cycles during
+ * VSYNC, so pixels per line is lineHigh * pclkEdges / (2 * pclkCycles).
+ */
+typedef struct{
+	uint32_t timeouts;
+	uint32_t abandonedFrames;
+	uint32_t tornFrames;
+	uint32_t shortLines;
+	uint32_t vsyncCycles;
+	uint32_t lines;
+	uint32_t lineCyclesMinimum;
+	uint32_t lineCyclesMaximum;
+	uint32_t lineHighMinimum;
+	uint32_t lineHighMaximum;
+	uint32_t pclkEdges;
+	uint32_t pclkCycles;
+} CAPTURE_HEALTH;
+
+/*
+ * The part of the sensor's frame to capture, in sensor scan order, the factor to
+ * decimate it by, how to store the pixels, and which way round. The orientation is
+ * relative to the sensor's scan: ROTATED (the original layout, last pixel first) stores
+ * lines and the pixels in them backwards, FLIPPED just the lines, MIRRORED just the
+ * pixels, and NORMAL stores everything in the order it arrives, so the host reads the
+ * frame front to back. Pixels are always B G R (or U Y V Y) in memory. RGB and UYVY need the camera in its GRB 4:2:2 and YUV 4:2:2
+ * modes respectively (see CameraManipulationScripts); Y8 keeps just the luma of the
+ * YUV mode, one byte per pixel. With its pixels stored backwards (ROTATED or
+ * MIRRORED) a UYVY line reads back as YVYU. The host writes captureConfiguration; PRU1 reads it as it starts each frame,
+ * and writes what the frame in imageData was actually captured with to
+ * frameConfiguration before setting the ready flag. The image is always packed at the
+ * start of imageData.
+ */
+#define CAPTURE_COLUMN_ALIGNMENT		4
+
+#define CAPTURE_FORMAT_RGB				0
+#define CAPTURE_FORMAT_UYVY				1
+#define CAPTURE_FORMAT_Y8				2
+
+#define CAPTURE_ORIENTATION_ROTATED		0
+#define CAPTURE_ORIENTATION_FLIPPED		1
+#define CAPTURE_ORIENTATION_MIRRORED	2
+#define CAPTURE_ORIENTATION_NORMAL		3
+#define CAPTURE_COLUMNS_FORWARD(orientation)	((orientation) & 1)
+#define CAPTURE_ROWS_FORWARD(orientation)		((orientation) & 2)
+
+typedef struct{
+	uint32_t firstColumn;
+	uint32_t firstRow;
+	uint32_t columns;
+	uint32_t rows;
+	uint32_t decimation;
+	uint32_t format;
+	uint32_t orientation;
+} CAPTURE_CONFIGURATION;
+
+/*
+ * Colour segmentation done by PRU1 while it captures an RGB frame. The host writes a
+ * box (B, G, R bounds, inclusive, as for inRange) to segmentationConfiguration; PRU1
+ * classifies every stored pixel against it and, before setting the ready flag, fills
+ * segmentationResult with the frame's matching runs and the mask's raw moments.
+ * Everything is in the stored image's pixels but in sensor scan order, so (0, 0) is
+ * the last pixel of the host's frame: a run's end is exclusive, and the host flips
+ * the coordinates. m10 and m01 are sums of column and row over matching pixels. Runs
+ * past SEGMENTATION_MAX_RUNS are counted in runsDropped but still in the moments.
+ */
+#define SEGMENTATION_MAX_RUNS			256
+
+typedef struct{
+	uint32_t enabled;
+	uint8_t low[3];
+	uint8_t high[3];
+	uint8_t reserved[2];
+} SEGMENTATION_CONFIGURATION;
+
+typedef struct{
+	uint16_t row;
+	uint16_t start;
+	uint16_t end;
+} SEGMENTATION_RUN;
+
+typedef struct{
+	uint32_t frame;
+	uint32_t m00;
+	uint32_t m10;
+	uint32_t m01;
+	uint32_t runCount;
+	uint32_t runsDropped;
+	SEGMENTATION_RUN runs[SEGMENTATION_MAX_RUNS];
+} SEGMENTATION_RESULT;
+
+/*
+ * The sensor resolution this firmware was built for, written by PRU1 as it starts.
+ * The carveout is zeroed when it is allocated, so zero means PRU1 hasn't got that far.
+ */
+typedef struct{
+	uint32_t columns;
+	uint32_t rows;
+} CAPTURE_SENSOR;
+
+/*
+ * A stand-in for the camera. While enabled PRU1 leaves the camera alone and draws each
+ * frame itself, one every periodMicroseconds at most (0 for as fast as the host takes
+ * them), with the same window, format, orientation, segmentation and handshake as a
+ * captured one. The pattern is eight colour bars across the sensor's width (white,
+ * yellow, cyan, green, magenta, red, blue, black: bar i has blue off if bit 0 of i is
+ * set, red if bit 1, green if bit 2) scrolling TEST_PATTERN_BAR_STEP columns a frame,
+ * and over them a pink square a bar wide, bouncing off the edges of the frame. The
+ * square is inside the default threshold box and none of the bars are. The pattern's
+ * frame n is the one delivered while captureStatistics.frames is n, so anything
+ * drawing it from these definitions draws the same frames.
+ */
+#define TEST_PATTERN_BARS				8
+#define TEST_PATTERN_BAR_STEP			2
+#define TEST_PATTERN_BLOB_STEP_COLUMNS	3
+#define TEST_PATTERN_BLOB_STEP_ROWS		2
+#define TEST_PATTERN_BLOB_BLUE			150
+#define TEST_PATTERN_BLOB_GREEN			40
+#define TEST_PATTERN_BLOB_RED			230
+#define TEST_PATTERN_BAR_CHANNEL(bar, channel)	(((bar) & ((channel) == 0 ? 1 : (channel) == 1 ? 4 : 2)) ? 0 : 255)
+/* distance travelled back and forth along range, as a position in 0 to range */
+#define TEST_PATTERN_BOUNCE(distance, range)	(((distance) % (2 * (range)) <= (range)) ? (distance) % (2 * (range)) : 2 * (range) - (distance) % (2 * (range)))
+
+typedef struct{
+	uint32_t enabled;
+	uint32_t periodMicroseconds;
+} TEST_PATTERN_CONFIGURATION;
+
+/*
+ * How often the host wants frames, which it may change at any time. PRU1 decides at
+ * each VSYNC whether to capture the frame it starts, and lets it go by, touching
+ * nothing but its own pins, unless this is at least the vsyncInterval'th VSYNC since
+ * the last frame captured (0 or 1 for every one) and that frame started at least
+ * frameIntervalMicroseconds ago (0 for no limit), give or take half a frame so the
+ * VSYNC nearest the interval is taken. The test pattern, having no VSYNC, only keeps
+ * to the interval. Intervals up to CAPTURE_GOVERNOR_MAX_MICROSECONDS are timed.
+ */
+#define CAPTURE_GOVERNOR_MAX_MICROSECONDS	10000000
+
+typedef struct{
+	uint32_t vsyncInterval;
+	uint32_t frameIntervalMicroseconds;
+} CAPTURE_GOVERNOR;
+
+/*
+ * Everything fixed in size comes first and the image last, so the host finds the rest
+ * at the same offsets whichever resolution the firmware was built for.
+ */
 typedef struct{
-	uint32_t imageData[IMAGE_COLUMNS_IN_INTS][IMAGE_ROWS_IN_PIXELS];
 	uint32_t imageReadyFlag;
+	CAPTURE_STATISTICS captureStatistics;
+	CAPTURE_CONFIGURATION captureConfiguration;
+	CAPTURE_CONFIGURATION frameConfiguration;
+	SEGMENTATION_CONFIGURATION segmentationConfiguration;
+	SEGMENTATION_RESULT segmentationResult;
+	CAPTURE_HEALTH captureHealth;
+	CAPTURE_SENSOR captureSensor;
+	TEST_PATTERN_CONFIGURATION testPatternConfiguration;
+	CAPTURE_GOVERNOR captureGovernor;
+	uint32_t imageData[IMAGE_CARVEOUT_INTS];
 } PRU_INTEROP_1_DATA;
 
 uint32_t *PRUInterop1GetImageData(void);
 uint32_t *PRUInterop1GetImageReadyFlag(void);
+CAPTURE_STATISTICS *PRUInterop1GetCaptureStatistics(void);
+CAPTURE_CONFIGURATION *PRUInterop1GetCaptureConfiguration(void);
+CAPTURE_CONFIGURATION *PRUInterop1GetFrameConfiguration(void);
+SEGMENTATION_CONFIGURATION *PRUInterop1GetSegmentationConfiguration(void);
+SEGMENTATION_RESULT *PRUInterop1GetSegmentationResult(void);
+CAPTURE_HEALTH *PRUInterop1GetCaptureHealth(void);
+CAPTURE_SENSOR *PRUInterop1GetCaptureSensor(void);
+TEST_PATTERN_CONFIGURATION *PRUInterop1GetTestPatternConfiguration(void);
+volatile PRU_INTEROP_1_HANDSHAKE *PRUInterop1GetHandshake(void);
+CAPTURE_GOVERNOR *PRUInterop1GetCaptureGovernor(void);
 
 #endif /* PRUINTEROP1_H_ */
@@ -5,47 +5,175 @@
  *      Author: Bill
  */
 
+#include <stdint.h>
+#include <pru_ctrl.h>
 #include "image.h"
 #include "PRUInterop1.h"
 
 extern volatile unsigned int *imageReadyFlag;
 unsigned int *imageData;
+volatile CAPTURE_STATISTICS *captureStatistics;
+volatile CAPTURE_CONFIGURATION *captureConfiguration;
+volatile CAPTURE_CONFIGURATION *frameConfiguration;
+volatile SEGMENTATION_CONFIGURATION *segmentationConfiguration;
+volatile SEGMENTATION_RESULT *segmentationResult;
+volatile CAPTURE_HEALTH *captureHealth;
+volatile TEST_PATTERN_CONFIGURATION *testPatternConfiguration;
+volatile PRU_INTEROP_1_HANDSHAKE *handshake;
+volatile CAPTURE_GOVERNOR *captureGovernor;
+unsigned int handedOver;
+
+/*
+ * The buffered capture assembles each line here, in PRU1's own data RAM where a store
+ * is a single cycle and never goes near the OCP bus, and flushes it to the carveout
+ * once HREF drops.
+ */
+IMAGE_BURST lineBuffer[IMAGE_COLUMNS_IN_BURSTS_RGB];
+
+/*
+ * The segmentation result is built up here during the frame, so a run costs a few
+ * local stores rather than a trip over the bus, and copied to the carveout in the
+ * vertical blanking. A channel matches when (value - low) <= range, as unsigned bytes.
+ */
+SEGMENTATION_RESULT segmentation;
+unsigned int segmenting;
+unsigned char segmentationLow[3];
+unsigned char segmentationRange[3];
+unsigned int segmentationRow;
+unsigned int segmentationInRun;
+unsigned int segmentationRunStart;
+
+/*
+ * A wait that gives up sets captureFault, and the buffered capture abandons the frame
+ * at the end of the line. Dropping pclkTimeoutSpins to one at the same time lets the
+ * rest of the line run out at once rather than timing out on every PCLK in it. The
+ * health counters are kept here and copied out after every attempt; vsyncCycle is the
+ * cycle count at the last VSYNC PRU1 saw, zero once the counter has been restarted.
+ */
+unsigned int captureFault;
+unsigned int pclkTimeoutSpins = PCLK_TIMEOUT_SPINS;
+CAPTURE_HEALTH health;
+uint32_t vsyncCycle;
+uint32_t pclkEdges;
+uint32_t pclkCycles;
+
+/*
+ * The test pattern's colours (the bars, then the square) in each format, worked out
+ * once, and the cycle count its last frame was started at.
+ */
+unsigned char testPatternBGR[TEST_PATTERN_BARS + 1][3];
+unsigned char testPatternLuma[TEST_PATTERN_BARS + 1];
+unsigned char testPatternChroma[TEST_PATTERN_BARS + 1][2];
+uint32_t testPatternStart;
+
+/*
+ * The capture governor's state: VSYNCs seen since the last frame captured, the cycle
+ * count at that frame's VSYNC (zero if unknown) and the frames let go by.
+ */
+uint32_t governorVSYNCs;
+uint32_t governorCycle;
+uint32_t governorSkipped;
 
 volatile register uint32_t __R31;
 
 extern inline void imageInitialize(void)
 {
 	imageData = (unsigned int *)PRUInterop1GetImageData();
+	captureStatistics = PRUInterop1GetCaptureStatistics();
+	captureConfiguration = PRUInterop1GetCaptureConfiguration();
+	frameConfiguration = PRUInterop1GetFrameConfiguration();
+	segmentationConfiguration = PRUInterop1GetSegmentationConfiguration();
+	segmentationResult = PRUInterop1GetSegmentationResult();
+	captureHealth = PRUInterop1GetCaptureHealth();
+	testPatternConfiguration = PRUInterop1GetTestPatternConfiguration();
+	handshake = PRUInterop1GetHandshake();
+	captureGovernor = PRUInterop1GetCaptureGovernor();
+	captureStatistics->skippedFrames = 0;
+	handshake->waits = 0;
+	handshake->waitCycles = 0;
+	handshake->carveoutReadCycles = 0;
+	handshake->frameTaken = 1;
+	handedOver = 0;
+	captureStatistics->frames = 0;
+	captureStatistics->flushOverruns = 0;
+	captureHealth->timeouts = 0;
+	captureHealth->abandonedFrames = 0;
+	captureHealth->tornFrames = 0;
+	captureHealth->shortLines = 0;
+
+	CAPTURE_SENSOR *captureSensor = PRUInterop1GetCaptureSensor();
+	captureSensor->columns = IMAGE_COLUMNS_IN_PIXELS;
+	captureSensor->rows = IMAGE_ROWS_IN_PIXELS;
+}
+
+static inline unsigned int imageWaitExpired(uint32_t start, uint32_t limit)
+{
+	if(PRU1_CTRL.CYCLE - start <= limit) return 0;
+	captureFault = 1;
+	pclkTimeoutSpins = 1;
+	health.timeouts++;
+	return 1;
+}
+
+/*
+ * The rare end of waitForPCLKRisingEdge. The wait is expanded at every pixel clock of
+ * every capture routine, close to a hundred times, so everything but the spinning is
+ * kept out of line here, where it costs instruction RAM once.
+ */
+void imagePCLKTimedOut(void)
+{
+	if(captureFault) return;
+	captureFault = 1;
+	pclkTimeoutSpins = 1;
+	health.timeouts++;
 }
 
 extern inline void waitForPCLKRisingEdge(void)
 {
-	while(__R31 & (1u << PCLK_PIN_ON_R31));
-	while(!(__R31 & (1u << PCLK_PIN_ON_R31)));
+	unsigned int spins = pclkTimeoutSpins;
+	while((__R31 & (1u << PCLK_PIN_ON_R31)) && --spins);
+	/* a budget spent waiting for the low half must not wrap round in the high half */
+	if(spins) while(!(__R31 & (1u << PCLK_PIN_ON_R31)) && --spins);
+	if(spins == 0) imagePCLKTimedOut();
 }
 
 extern inline void waitForHREFRisingEdge(void)
 {
-	while(__R31 & (1u << HREF_PIN_ON_R31));
-	while(!(__R31 & (1u << HREF_PIN_ON_R31)));
+	const uint32_t start = PRU1_CTRL.CYCLE;
+	if(captureFault) return;
+	while((__R31 & (1u << HREF_PIN_ON_R31)) && !imageWaitExpired(start, HREF_TIMEOUT_CYCLES));
+	while(!(__R31 & (1u << HREF_PIN_ON_R31)) && !imageWaitExpired(start, HREF_TIMEOUT_CYCLES));
 }
 
 extern inline void waitForHREFFallingEdge(void)
 {
-	while(__R31 & (1u << HREF_PIN_ON_R31));
+	const uint32_t start = PRU1_CTRL.CYCLE;
+	if(captureFault) return;
+	while((__R31 & (1u << HREF_PIN_ON_R31)) && !imageWaitExpired(start, HREF_TIMEOUT_CYCLES));
 }
 
+/*
+ * PCLK keeps running while VSYNC is high, so the edges counted then, over the cycles
+ * they took, give the pixel clock for the health figures.
+ */
 extern inline void waitForVSYNCFallingEdge(void)
 {
+	const uint32_t start = PRU1_CTRL.CYCLE;
+	uint32_t edges = 0;
 
+	if(captureFault) return;
 	do{
 		waitForPCLKRisingEdge();
-	}while(!(__R31 & (1u << VSYNC_PIN_ON_R31)));
+	}while(!(__R31 & (1u << VSYNC_PIN_ON_R31)) && !captureFault && !imageWaitExpired(start, VSYNC_TIMEOUT_CYCLES));
 
+	const uint32_t high = PRU1_CTRL.CYCLE;
 	do{
 		waitForPCLKRisingEdge();
-	}while(__R31 & (1u << VSYNC_PIN_ON_R31));
+		edges++;
+	}while((__R31 & (1u << VSYNC_PIN_ON_R31)) && !captureFault && !imageWaitExpired(start, VSYNC_TIMEOUT_CYCLES));
 
+	pclkEdges = edges;
+	pclkCycles = PRU1_CTRL.CYCLE - high;
 }
 
 extern inline void getImageUYUV(void)
@@ -218,6 +346,1064 @@ void getImageGRB422(void)
 		}
 		waitForHREFFallingEdge();
 	}
+
+	captureStatistics->busWrites = IMAGE_ROWS_IN_PIXELS * IMAGE_COLUMNS_IN_INTS_RGB;
+	captureStatistics->busWriteBytes = sizeof(int);
+	captureStatistics->flushCycles = 0;
+	captureStatistics->frames++;
+}
+
+/*
+ * Copies the assembled line to its place in the carveout a burst at a time (and any
+ * tail shorter than a burst an int at a time), timing it with the cycle counter.
+ */
+static inline unsigned int imageCopyLine(unsigned char *l_DDRLine, unsigned int lineBytes, uint32_t *flushCycles)
+{
+	IMAGE_BURST *l_burstTo = (IMAGE_BURST *)l_DDRLine;
+	IMAGE_BURST *l_burstFrom = lineBuffer;
+	unsigned int *l_intTo;
+	unsigned int *l_intFrom;
+	unsigned int bursts = lineBytes / IMAGE_BURST_BYTES;
+	unsigned int ints = (lineBytes % IMAGE_BURST_BYTES) / sizeof(int);
+	uint32_t start = PRU1_CTRL.CYCLE;
+
+	for(unsigned int burstCounter = 0; burstCounter < bursts; burstCounter++)
+	{
+		*(l_burstTo++) = *(l_burstFrom++);
+	}
+	l_intTo = (unsigned int *)l_burstTo;
+	l_intFrom = (unsigned int *)l_burstFrom;
+	for(unsigned int intCounter = 0; intCounter < ints; intCounter++)
+	{
+		*(l_intTo++) = *(l_intFrom++);
+	}
+
+	*flushCycles += PRU1_CTRL.CYCLE - start;
+	return bursts + ints;
+}
+
+/*
+ * A captured line's copy. If HREF is already back up when it finishes, the flush ran
+ * past the blanking interval and the start of the next line was missed.
+ */
+static inline unsigned int imageFlushLine(unsigned char *l_DDRLine, unsigned int lineBytes, uint32_t *flushCycles)
+{
+	const unsigned int busWrites = imageCopyLine(l_DDRLine, lineBytes, flushCycles);
+
+	if(__R31 & (1u << HREF_PIN_ON_R31)) captureStatistics->flushOverruns++;
+	return busWrites;
+}
+
+/*
+ * Takes this frame's window, decimation and format from the host, falling back to the
+ * whole frame if the window isn't something the capture can produce: decimation of 1,
+ * 2 or 4, a first column on a CAPTURE_COLUMN_ALIGNMENT boundary, a width that
+ * decimates to a multiple of CAPTURE_COLUMN_ALIGNMENT pixels (so a line is a whole
+ * number of ints in any format), a height that is a multiple of the decimation, all
+ * inside the sensor's frame. An unknown format falls back to RGB.
+ */
+static void imageReadConfiguration(CAPTURE_CONFIGURATION *configuration)
+{
+	configuration->firstColumn = captureConfiguration->firstColumn;
+	configuration->firstRow = captureConfiguration->firstRow;
+	configuration->columns = captureConfiguration->columns;
+	configuration->rows = captureConfiguration->rows;
+	configuration->decimation = captureConfiguration->decimation;
+	configuration->format = captureConfiguration->format;
+	configuration->orientation = captureConfiguration->orientation & CAPTURE_ORIENTATION_NORMAL;
+
+	if(configuration->format != CAPTURE_FORMAT_UYVY && configuration->format != CAPTURE_FORMAT_Y8) configuration->format = CAPTURE_FORMAT_RGB;
+
+	unsigned int decimation = configuration->decimation;
+	if((decimation != 1 && decimation != 2 && decimation != 4) ||
+		configuration->columns == 0 ||
+		configuration->rows == 0 ||
+		(configuration->firstColumn & (CAPTURE_COLUMN_ALIGNMENT - 1)) ||
+		(configuration->columns & (CAPTURE_COLUMN_ALIGNMENT * decimation - 1)) ||
+		(configuration->rows & (decimation - 1)) ||
+		configuration->firstColumn + configuration->columns > IMAGE_COLUMNS_IN_PIXELS ||
+		configuration->firstRow + configuration->rows > IMAGE_ROWS_IN_PIXELS)
+	{
+		configuration->firstColumn = 0;
+		configuration->firstRow = 0;
+		configuration->columns = IMAGE_COLUMNS_IN_PIXELS;
+		configuration->rows = IMAGE_ROWS_IN_PIXELS;
+		configuration->decimation = 1;
+	}
+}
+
+/*
+ * The sensor sends pixels in pairs, G R G B, the two pixels sharing R and B. Skipping
+ * a pair is just letting its four clocks go by. Nothing is read, so there is no hurry
+ * getting here: it is called rather than inlined, one copy of its four waits for all
+ * its callers.
+ */
+static void imageSkipPairs(unsigned int pairs)
+{
+	for(unsigned int pairCounter = 0; pairCounter < pairs; pairCounter++)
+	{
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+	}
+}
+
+/*
+ * A PCLK whose byte the decimated routines don't keep. As for imageSkipPairs, it
+ * only has to return before the next edge, so it is a call.
+ */
+static void imageSkipPCLK(void)
+{
+	waitForPCLKRisingEdge();
+}
+
+/*
+ * Takes this frame's box from the host. Segmentation is only done on RGB captures,
+ * decimated ones only unless IMAGE_SEGMENT_FULL_RESOLUTION, and a box with any high
+ * bound below its low bound matches nothing, so isn't run.
+ */
+static void imageReadSegmentation(const CAPTURE_CONFIGURATION *configuration)
+{
+	segmenting = segmentationConfiguration->enabled && configuration->format == CAPTURE_FORMAT_RGB &&
+					(IMAGE_SEGMENT_FULL_RESOLUTION || configuration->decimation != 1);
+	for(unsigned int channel = 0; channel < 3; channel++)
+	{
+		segmentationLow[channel] = segmentationConfiguration->low[channel];
+		if(segmentationConfiguration->high[channel] < segmentationLow[channel]) segmenting = 0;
+		segmentationRange[channel] = segmentationConfiguration->high[channel] - segmentationLow[channel];
+	}
+	segmentation.m00 = 0;
+	segmentation.m10 = 0;
+	segmentation.m01 = 0;
+	segmentation.runCount = 0;
+	segmentation.runsDropped = 0;
+}
+
+static inline void imageSegmentationStartLine(unsigned int row)
+{
+	segmentationRow = row;
+	segmentationInRun = 0;
+}
+
+/*
+ * The moments of a run come straight from its ends: length pixels, whose columns sum
+ * to (start + end - 1) * length / 2. Only a run's end gets here, so it is called rather
+ * than inlined into every copy of imageSegmentPixel.
+ */
+static void imageSegmentationCloseRun(unsigned int end)
+{
+	const unsigned int length = end - segmentationRunStart;
+
+	segmentation.m00 += length;
+	segmentation.m10 += ((segmentationRunStart + end - 1) * length) >> 1;
+	segmentation.m01 += segmentationRow * length;
+	if(segmentation.runCount < SEGMENTATION_MAX_RUNS)
+	{
+		SEGMENTATION_RUN *run = &(segmentation.runs[segmentation.runCount++]);
+		run->row = segmentationRow;
+		run->start = segmentationRunStart;
+		run->end = end;
+	}
+	else
+	{
+		segmentation.runsDropped++;
+	}
+	segmentationInRun = 0;
+}
+
+static inline void imageSegmentationEndLine(unsigned int columns)
+{
+	if(segmentationInRun) imageSegmentationCloseRun(columns);
+}
+
+/*
+ * Classifies one pixel. Nothing happens unless it starts or ends a run, so a pixel
+ * costs three subtract/compares and a branch.
+ */
+static inline void imageSegmentPixel(unsigned int column, unsigned char blue, unsigned char green, unsigned char red)
+{
+	const unsigned int match = (unsigned char)(blue - segmentationLow[0]) <= segmentationRange[0] &&
+								(unsigned char)(green - segmentationLow[1]) <= segmentationRange[1] &&
+								(unsigned char)(red - segmentationLow[2]) <= segmentationRange[2];
+
+	if(match == segmentationInRun) return;
+	if(match)
+	{
+		segmentationRunStart = column;
+		segmentationInRun = 1;
+	}
+	else
+	{
+		imageSegmentationCloseRun(column);
+	}
+}
+
+/*
+ * Copies what the frame's segmentation found to the carveout, only as many runs as
+ * there are.
+ */
+static void imageWriteSegmentation(uint32_t frame)
+{
+	const unsigned int runCount = segmenting ? segmentation.runCount : 0;
+
+	for(unsigned int runCounter = 0; runCounter < runCount; runCounter++)
+	{
+		segmentationResult->runs[runCounter] = segmentation.runs[runCounter];
+	}
+	segmentationResult->m00 = segmenting ? segmentation.m00 : 0;
+	segmentationResult->m10 = segmenting ? segmentation.m10 : 0;
+	segmentationResult->m01 = segmenting ? segmentation.m01 : 0;
+	segmentationResult->runCount = runCount;
+	segmentationResult->runsDropped = segmenting ? segmentation.runsDropped : 0;
+	segmentationResult->frame = segmenting ? frame : 0;
+}
+
+/*
+ * Full resolution: four pixels (three ints) per pass, put together in registers as
+ * getImageGRB422 does, last int of the line first.
+ */
+static void imageCaptureLine(unsigned int lineBytes, unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)((unsigned char *)lineBuffer + lineBytes) - 1;
+	YUVandIntUnion data1;
+	YUVandIntUnion data2;
+	YUVandIntUnion data3;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//get G 1
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		//get R 2
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		data1.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		//get G 3
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		//get B 4
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		data2.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		//buffer first int
+		*(l_line--) = data1.asUInt;
+
+		//get G 5
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		//get R 6
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		//buffer second int
+		*(l_line--) = data2.asUInt;
+
+		//get G 7
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//get B 8
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		//buffer third int
+		*(l_line--) = data3.asUInt;
+	}
+}
+
+#if IMAGE_SEGMENT_FULL_RESOLUTION
+/*
+ * imageCaptureLine with each pixel classified once its blue has arrived. The work is
+ * spread so no PCLK slot gets more than one pixel's worth: a pass's last pixel is
+ * classified in the first slot of the next (whose byte goes to data1, which it
+ * doesn't use), and the line's last once the loop is done.
+ */
+static void imageCaptureLineSegmented(unsigned int lineBytes, unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)((unsigned char *)lineBuffer + lineBytes) - 1;
+	unsigned int column = 0;
+	YUVandIntUnion data1;
+	YUVandIntUnion data2;
+	YUVandIntUnion data3;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//get G 1
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		if(columnCounter) imageSegmentPixel(column - 1, data3.asCb0Y0Cr0Y1.byte3, data3.asCb0Y0Cr0Y1.byte1, data2.asCb0Y0Cr0Y1.byte1);
+		//get R 2
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		data1.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		//get G 3
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		//get B 4
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		data2.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		*(l_line--) = data1.asUInt;
+		imageSegmentPixel(column, data1.asCb0Y0Cr0Y1.byte1, data1.asCb0Y0Cr0Y1.byte2, data1.asCb0Y0Cr0Y1.byte3);
+
+		//get G 5
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		imageSegmentPixel(column + 1, data2.asCb0Y0Cr0Y1.byte2, data2.asCb0Y0Cr0Y1.byte3, data1.asCb0Y0Cr0Y1.byte3);
+		//get R 6
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		*(l_line--) = data2.asUInt;
+
+		//get G 7
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//get B 8
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		*(l_line--) = data3.asUInt;
+		imageSegmentPixel(column + 2, data3.asCb0Y0Cr0Y1.byte3, data2.asCb0Y0Cr0Y1.byte0, data2.asCb0Y0Cr0Y1.byte1);
+		column += 4;
+	}
+	if(passes) imageSegmentPixel(column - 1, data3.asCb0Y0Cr0Y1.byte3, data3.asCb0Y0Cr0Y1.byte1, data2.asCb0Y0Cr0Y1.byte1);
+}
+#endif
+
+/*
+ * Decimated: the first pixel of every (decimation / 2)th pair is kept, written a byte
+ * at a time into the line buffer (B G R in memory, in either order), and the rest of
+ * the pairs are skipped. The skipped pairs leave plenty of time to classify the kept
+ * pixel when segmenting.
+ */
+static void imageCaptureLineDecimated(unsigned int lineBytes, unsigned int pixels, unsigned int skippedPairs, unsigned int forward)
+{
+	unsigned char *l_pixel = (unsigned char *)lineBuffer + (forward ? 0 : lineBytes - BYTES_PER_PIXEL_RGB);
+	const int step = forward ? BYTES_PER_PIXEL_RGB : -BYTES_PER_PIXEL_RGB;
+	unsigned char green;
+	unsigned char red;
+
+	for(unsigned int columnCounter = 0; columnCounter < pixels; columnCounter++)
+	{
+		//get G 1
+		waitForPCLKRisingEdge();
+		green = (unsigned char)__R31;
+		//get R 2
+		waitForPCLKRisingEdge();
+		red = (unsigned char)__R31;
+		//skip G 3
+		imageSkipPCLK();
+		l_pixel[2] = red;
+		l_pixel[1] = green;
+		//get B 4
+		waitForPCLKRisingEdge();
+		l_pixel[0] = (unsigned char)__R31;
+		if(segmenting) imageSegmentPixel(columnCounter, l_pixel[0], green, red);
+		l_pixel += step;
+
+		imageSkipPairs(skippedPairs);
+	}
+}
+
+/*
+ * Full resolution UYVY: one pixel pair (one int) per pass, byte for byte, last int of
+ * the line first, as getImageUYUV does.
+ */
+static void imageCaptureLineUYVY(unsigned int lineBytes, unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)((unsigned char *)lineBuffer + lineBytes) - 1;
+	YUVandIntUnion data;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		*(l_line--) = data.asUInt;
+	}
+}
+
+/*
+ * Decimated UYVY: each output pair takes U, Y and V from the first pair it covers and
+ * just Y from the first pair of the next step, so the chroma is sampled at the same
+ * place as in the full resolution image.
+ */
+static void imageCaptureLineUYVYDecimated(unsigned int lineBytes, unsigned int passes, unsigned int skippedPairs, unsigned int forward)
+{
+	const unsigned int pairBytes = BYTES_PER_PIXEL_UYUV * 2;
+	unsigned char *l_pair = (unsigned char *)lineBuffer + (forward ? 0 : lineBytes - pairBytes);
+	const int step = forward ? (int)pairBytes : -(int)pairBytes;
+	/* where U, the first Y, V and the second Y go in a stored pair */
+	const unsigned int u = forward ? 0 : 3;
+	const unsigned int y0 = forward ? 1 : 2;
+	const unsigned int v = 3 - y0;
+	const unsigned int y1 = 3 - u;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//get U
+		waitForPCLKRisingEdge();
+		l_pair[u] = (unsigned char)__R31;
+		//get Y 0
+		waitForPCLKRisingEdge();
+		l_pair[y0] = (unsigned char)__R31;
+		//get V
+		waitForPCLKRisingEdge();
+		l_pair[v] = (unsigned char)__R31;
+		//skip Y 1
+		imageSkipPCLK();
+		imageSkipPairs(skippedPairs);
+
+		//skip U
+		imageSkipPCLK();
+		//get Y 0
+		waitForPCLKRisingEdge();
+		l_pair[y1] = (unsigned char)__R31;
+		//skip V, Y 1
+		imageSkipPCLK();
+		imageSkipPCLK();
+		imageSkipPairs(skippedPairs);
+
+		l_pair += step;
+	}
+}
+
+/*
+ * Y8: the luma bytes of the YUV 4:2:2 stream only. Four pixels (one int) per pass at
+ * full resolution; decimated, the first Y of every (decimation / 2)th pair.
+ */
+static void imageCaptureLineY8(unsigned int lineBytes, unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)((unsigned char *)lineBuffer + lineBytes) - 1;
+	YUVandIntUnion data;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//skip U, get Y 0, skip V, get Y 1
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		//and again for the next pair
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		*(l_line--) = data.asUInt;
+	}
+}
+
+static void imageCaptureLineY8Decimated(unsigned int lineBytes, unsigned int pixels, unsigned int skippedPairs, unsigned int forward)
+{
+	unsigned char *l_line = (unsigned char *)lineBuffer + (forward ? 0 : lineBytes - 1);
+	const int step = forward ? 1 : -1;
+
+	for(unsigned int columnCounter = 0; columnCounter < pixels; columnCounter++)
+	{
+		//skip U, get Y 0, skip V, Y 1
+		imageSkipPCLK();
+		waitForPCLKRisingEdge();
+		*l_line = (unsigned char)__R31;
+		l_line += step;
+		imageSkipPCLK();
+		imageSkipPCLK();
+		imageSkipPairs(skippedPairs);
+	}
+}
+
+/*
+ * The full resolution routines again, storing the line front to back. Each int is
+ * put together in memory order, B G R B / G R B G / R B G R for RGB, so a pass still
+ * stores three ints but the first only once the fourth byte (B 4) is in and the
+ * other two at the end of the pass.
+ */
+static void imageCaptureLineForward(unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)lineBuffer;
+	YUVandIntUnion data1;
+	YUVandIntUnion data2;
+	YUVandIntUnion data3;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//get G 1
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//get R 2
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		data2.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//get G 3
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		//get B 4
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		data1.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		//buffer first int
+		*(l_line++) = data1.asUInt;
+
+		//get G 5
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		//get R 6
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		//get G 7
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		//get B 8
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//buffer second and third ints
+		*(l_line++) = data2.asUInt;
+		*(l_line++) = data3.asUInt;
+	}
+}
+
+#if IMAGE_SEGMENT_FULL_RESOLUTION
+static void imageCaptureLineSegmentedForward(unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)lineBuffer;
+	unsigned int column = 0;
+	YUVandIntUnion data1;
+	YUVandIntUnion data2;
+	YUVandIntUnion data3;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//get G 1
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		if(columnCounter) imageSegmentPixel(column - 1, data2.asCb0Y0Cr0Y1.byte2, data3.asCb0Y0Cr0Y1.byte2, data3.asCb0Y0Cr0Y1.byte0);
+		//get R 2
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		data2.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//get G 3
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		//get B 4
+		waitForPCLKRisingEdge();
+		data1.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		data1.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		*(l_line++) = data1.asUInt;
+		imageSegmentPixel(column, data1.asCb0Y0Cr0Y1.byte0, data1.asCb0Y0Cr0Y1.byte1, data1.asCb0Y0Cr0Y1.byte2);
+
+		//get G 5
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		imageSegmentPixel(column + 1, data1.asCb0Y0Cr0Y1.byte0, data2.asCb0Y0Cr0Y1.byte0, data1.asCb0Y0Cr0Y1.byte2);
+		//get R 6
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		//get G 7
+		waitForPCLKRisingEdge();
+		data3.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		//get B 8
+		waitForPCLKRisingEdge();
+		data2.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		data3.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		*(l_line++) = data2.asUInt;
+		*(l_line++) = data3.asUInt;
+		imageSegmentPixel(column + 2, data2.asCb0Y0Cr0Y1.byte2, data2.asCb0Y0Cr0Y1.byte3, data3.asCb0Y0Cr0Y1.byte0);
+		column += 4;
+	}
+	if(passes) imageSegmentPixel(column - 1, data2.asCb0Y0Cr0Y1.byte2, data3.asCb0Y0Cr0Y1.byte2, data3.asCb0Y0Cr0Y1.byte0);
+}
+#endif
+
+static void imageCaptureLineUYVYForward(unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)lineBuffer;
+	YUVandIntUnion data;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		*(l_line++) = data.asUInt;
+	}
+}
+
+static void imageCaptureLineY8Forward(unsigned int passes)
+{
+	unsigned int *l_line = (unsigned int *)lineBuffer;
+	YUVandIntUnion data;
+
+	for(unsigned int columnCounter = 0; columnCounter < passes; columnCounter++)
+	{
+		//skip U, get Y 0, skip V, get Y 1
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte0 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte1 = (unsigned char)__R31;
+		//and again for the next pair
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte2 = (unsigned char)__R31;
+		waitForPCLKRisingEdge();
+		waitForPCLKRisingEdge();
+		data.asCb0Y0Cr0Y1.byte3 = (unsigned char)__R31;
+		*(l_line++) = data.asUInt;
+	}
+}
+
+/*
+ * Stores one line of the window in the configured format and order. The routines it
+ * picks between are each called from here only, so they are left as calls rather than
+ * inlined: one more jump at the start of a line, but one copy of each in instruction
+ * RAM however the compiler would otherwise have laid them out.
+ */
+static inline void imageCaptureLineFormatted(const CAPTURE_CONFIGURATION *configuration, unsigned int lineBytes, unsigned int outputColumns)
+{
+	const unsigned int skippedPairs = configuration->decimation / 2 - 1;
+	const unsigned int forward = CAPTURE_COLUMNS_FORWARD(configuration->orientation);
+
+	switch(configuration->format)
+	{
+		case CAPTURE_FORMAT_UYVY:
+			if(configuration->decimation != 1) imageCaptureLineUYVYDecimated(lineBytes, outputColumns / 2, skippedPairs, forward);
+			else if(forward) imageCaptureLineUYVYForward(outputColumns / 2);
+			else imageCaptureLineUYVY(lineBytes, outputColumns / 2);
+			break;
+		case CAPTURE_FORMAT_Y8:
+			if(configuration->decimation != 1) imageCaptureLineY8Decimated(lineBytes, outputColumns, skippedPairs, forward);
+			else if(forward) imageCaptureLineY8Forward(outputColumns / 4);
+			else imageCaptureLineY8(lineBytes, outputColumns / 4);
+			break;
+		default:
+			if(configuration->decimation != 1) imageCaptureLineDecimated(lineBytes, outputColumns, skippedPairs, forward);
+#if IMAGE_SEGMENT_FULL_RESOLUTION
+			else if(segmenting && forward) imageCaptureLineSegmentedForward(outputColumns / 4);
+			else if(segmenting) imageCaptureLineSegmented(lineBytes, outputColumns / 4);
+#endif
+			else if(forward) imageCaptureLineForward(outputColumns / 4);
+			else imageCaptureLine(lineBytes, outputColumns / 4);
+			break;
+	}
+}
+
+/*
+ * The same capture as getImageGRB422 (whose layout, last pixel first, is the ROTATED
+ * orientation), but each line is put together in lineBuffer and written to DDR in
+ * IMAGE_BURST_BYTES bursts during horizontal blanking, rather than one int at a time
+ * while pixels are arriving. That is an eighth of the bus transactions, and none of
+ * them compete with the pixel clock. Only the host's window is stored, decimated as
+ * asked, so lines and pixels outside it cost no bus traffic at all; the result is
+ * packed at the start of imageData as an image of the window's decimated size, in the
+ * host's chosen format (RGB, UYVY or Y8: 3, 2 or 1 bytes per pixel) and orientation.
+ * NORMAL stores front to back, so the host's reads stream forwards.
+ */
+/*
+ * The cycle counter stops when it saturates, so it is restarted well before then, and
+ * the next VSYNC period then goes unmeasured. Every wait in a frame is timed from a
+ * reading taken within it, so a restart between frames never upsets them.
+ */
+static unsigned int imageRestartCycleCounter(void)
+{
+	if(PRU1_CTRL.CYCLE < CYCLE_COUNTER_RESTART) return 0;
+	PRU1_CTRL.CTRL_bit.CTR_EN = 0;
+	PRU1_CTRL.CYCLE = 0;
+	PRU1_CTRL.CTRL_bit.CTR_EN = 1;
+	vsyncCycle = 0;
+	governorCycle = 0;
+	return 1;
+}
+
+static void imageStartHealth(void)
+{
+	imageRestartCycleCounter();
+	captureFault = 0;
+	pclkTimeoutSpins = PCLK_TIMEOUT_SPINS;
+	health.lines = 0;
+	health.lineCyclesMinimum = 0xFFFFFFFF;
+	health.lineCyclesMaximum = 0;
+	health.lineHighMinimum = 0xFFFFFFFF;
+	health.lineHighMaximum = 0;
+}
+
+static inline void imageRecordVSYNC(void)
+{
+	const uint32_t now = PRU1_CTRL.CYCLE;
+
+	health.vsyncCycles = (vsyncCycle != 0 && !captureFault) ? now - vsyncCycle : 0;
+	vsyncCycle = captureFault ? 0 : now;
+	health.pclkEdges = pclkEdges;
+	health.pclkCycles = pclkCycles;
+}
+
+static inline void imageRecordLineStart(uint32_t rise, uint32_t previousRise)
+{
+	health.lines++;
+	if(previousRise == 0) return;
+	const uint32_t period = rise - previousRise;
+	if(period < health.lineCyclesMinimum) health.lineCyclesMinimum = period;
+	if(period > health.lineCyclesMaximum) health.lineCyclesMaximum = period;
+}
+
+/*
+ * Only called when HREF was seen to fall, so the time is exact. Short means HREF was
+ * high for less time than the sensor's width in PCLKs, bar the slack, would take.
+ */
+static inline void imageRecordLineEnd(uint32_t rise)
+{
+	const uint32_t high = PRU1_CTRL.CYCLE - rise;
+
+	if(high < health.lineHighMinimum) health.lineHighMinimum = high;
+	if(high > health.lineHighMaximum) health.lineHighMaximum = high;
+	if(health.pclkEdges != 0 &&
+		high * health.pclkEdges < (IMAGE_COLUMNS_IN_PIXELS * BYTES_PER_PIXEL_UYUV - SHORT_LINE_SLACK_PCLKS) * health.pclkCycles)
+	{
+		health.shortLines++;
+	}
+}
+
+static void imageWriteHealth(void)
+{
+	captureHealth->timeouts = health.timeouts;
+	captureHealth->abandonedFrames = health.abandonedFrames;
+	captureHealth->tornFrames = health.tornFrames;
+	captureHealth->shortLines = health.shortLines;
+	captureHealth->vsyncCycles = health.vsyncCycles;
+	captureHealth->lines = health.lines;
+	captureHealth->lineCyclesMinimum = health.lineCyclesMinimum;
+	captureHealth->lineCyclesMaximum = health.lineCyclesMaximum;
+	captureHealth->lineHighMinimum = health.lineHighMinimum;
+	captureHealth->lineHighMaximum = health.lineHighMaximum;
+	captureHealth->pclkEdges = health.pclkEdges;
+	captureHealth->pclkCycles = health.pclkCycles;
+}
+
+/*
+ * Called at each VSYNC, after imageRecordVSYNC. A frame whose start can't be timed
+ * (vsyncCycle is zero after a fault or a counter restart) is only held to the VSYNC
+ * count.
+ */
+static inline unsigned int imageGovernorSkips(void)
+{
+	const uint32_t interval = captureGovernor->frameIntervalMicroseconds * PRU_CYCLES_PER_MICROSECOND;
+
+	governorVSYNCs++;
+	if(governorVSYNCs < captureGovernor->vsyncInterval) return 1;
+	if(interval != 0 && governorCycle != 0 && vsyncCycle != 0 &&
+		vsyncCycle - governorCycle + health.vsyncCycles / 2 < interval)
+	{
+		return 1;
+	}
+	governorVSYNCs = 0;
+	governorCycle = vsyncCycle;
+	return 0;
+}
+
+/*
+ * Tells the host what the frame in imageData is and how it got there, and hands over
+ * the segmentation done while it was made.
+ */
+static void imageFinishFrame(const CAPTURE_CONFIGURATION *configuration, uint32_t busWrites, uint32_t flushCycles)
+{
+	frameConfiguration->firstColumn = configuration->firstColumn;
+	frameConfiguration->firstRow = configuration->firstRow;
+	frameConfiguration->columns = configuration->columns;
+	frameConfiguration->rows = configuration->rows;
+	frameConfiguration->decimation = configuration->decimation;
+	frameConfiguration->format = configuration->format;
+	frameConfiguration->orientation = configuration->orientation;
+
+	captureStatistics->busWrites = busWrites;
+	captureStatistics->busWriteBytes = IMAGE_BURST_BYTES;
+	captureStatistics->flushCycles = flushCycles;
+	captureStatistics->skippedFrames = governorSkipped;
+	captureStatistics->frames++;
+	imageWriteSegmentation(captureStatistics->frames);
+}
+
+/*
+ * Returns zero if the frame was abandoned: a wait timed out, or VSYNC came round again
+ * before the last row (the frame is torn). Nothing but the health figures is written
+ * then, and the caller leaves the ready flag alone and starts over at the next VSYNC.
+ */
+unsigned int getImageGRB422Buffered(void)
+{
+	CAPTURE_CONFIGURATION configuration;
+	imageReadConfiguration(&configuration);
+	imageReadSegmentation(&configuration);
+
+	const unsigned int decimation = configuration.decimation;
+	const unsigned int outputRows = configuration.rows / decimation;
+	const unsigned int outputColumns = configuration.columns / decimation;
+	const unsigned int bytesPerPixel = (configuration.format == CAPTURE_FORMAT_Y8) ? BYTES_PER_PIXEL_Y8 :
+										(configuration.format == CAPTURE_FORMAT_UYVY) ? BYTES_PER_PIXEL_UYUV : BYTES_PER_PIXEL_RGB;
+	const unsigned int lineBytes = outputColumns * bytesPerPixel;
+	const int lineStep = CAPTURE_ROWS_FORWARD(configuration.orientation) ? (int)lineBytes : -(int)lineBytes;
+	unsigned char *l_DDRLine = (unsigned char *)imageData + (CAPTURE_ROWS_FORWARD(configuration.orientation) ? 0 : (outputRows - 1) * lineBytes);
+	unsigned int nextRow = configuration.firstRow;
+	unsigned int capturedRows = 0;
+	uint32_t busWrites = 0;
+	uint32_t flushCycles = 0;
+	uint32_t previousRise = 0;
+	const unsigned int windowReachesEnd = (configuration.firstColumn + configuration.columns == IMAGE_COLUMNS_IN_PIXELS);
+
+	imageStartHealth();
+	waitForVSYNCFallingEdge();
+	imageRecordVSYNC();
+	while(!captureFault && imageGovernorSkips())
+	{
+		governorSkipped++;
+		waitForVSYNCFallingEdge();
+		imageRecordVSYNC();
+	}
+
+	for(unsigned int rowCounter = 0; rowCounter < IMAGE_ROWS_IN_PIXELS && capturedRows < outputRows && !captureFault; rowCounter++)
+	{
+		waitForHREFRisingEdge();
+		const uint32_t rise = PRU1_CTRL.CYCLE;
+		if(captureFault) break;
+		if(__R31 & (1u << VSYNC_PIN_ON_R31))
+		{
+			health.tornFrames++;
+			captureFault = 1;
+			break;
+		}
+		imageRecordLineStart(rise, previousRise);
+		previousRise = rise;
+
+		if(rowCounter != nextRow)
+		{
+			waitForHREFFallingEdge();
+			if(!captureFault) imageRecordLineEnd(rise);
+			continue;
+		}
+		nextRow += decimation;
+
+		waitForPCLKRisingEdge();
+		imageSkipPairs(configuration.firstColumn / 2);
+		imageSegmentationStartLine(capturedRows);
+		imageCaptureLineFormatted(&configuration, lineBytes, outputColumns);
+		const unsigned int ended = !(__R31 & (1u << HREF_PIN_ON_R31));
+		if(segmenting) imageSegmentationEndLine(outputColumns);
+		waitForHREFFallingEdge();
+		if(captureFault) break;
+		/* HREF gone before the window ran out of the line means the line was cut short;
+		 * if it was still up, the fall just seen gives the line's true length. */
+		if(!ended) imageRecordLineEnd(rise);
+		else if(!windowReachesEnd) health.shortLines++;
+
+		busWrites += imageFlushLine(l_DDRLine, lineBytes, &flushCycles);
+		l_DDRLine += lineStep;
+		capturedRows++;
+	}
+
+	if(captureFault || capturedRows < outputRows)
+	{
+		health.abandonedFrames++;
+		vsyncCycle = 0;
+		imageWriteHealth();
+		return 0;
+	}
+
+	imageFinishFrame(&configuration, busWrites, flushCycles);
+	imageWriteHealth();
+	return 1;
 }
 
+/*
+ * The pattern's colours, the bars from TEST_PATTERN_BAR_CHANNEL and the square last,
+ * with the BT.601 luma and chroma the camera's YUV mode would give for them.
+ */
+static void imageTestPatternColours(void)
+{
+	for(unsigned int colour = 0; colour <= TEST_PATTERN_BARS; colour++)
+	{
+		unsigned char *bgr = testPatternBGR[colour];
+		if(colour < TEST_PATTERN_BARS)
+		{
+			bgr[0] = TEST_PATTERN_BAR_CHANNEL(colour, 0);
+			bgr[1] = TEST_PATTERN_BAR_CHANNEL(colour, 1);
+			bgr[2] = TEST_PATTERN_BAR_CHANNEL(colour, 2);
+		}
+		else
+		{
+			bgr[0] = TEST_PATTERN_BLOB_BLUE;
+			bgr[1] = TEST_PATTERN_BLOB_GREEN;
+			bgr[2] = TEST_PATTERN_BLOB_RED;
+		}
+
+		const int luma = (29 * bgr[0] + 150 * bgr[1] + 77 * bgr[2]) >> 8;
+		for(unsigned int chroma = 0; chroma < 2; chroma++)
+		{
+			int value = ((bgr[chroma * 2] - luma) * (chroma ? 182 : 144) >> 8) + 128;
+			testPatternChroma[colour][chroma] = (value < 0) ? 0 : (value > 255) ? 255 : value;
+		}
+		testPatternLuma[colour] = luma;
+	}
+}
+
+/*
+ * Draws one line of the pattern into the line buffer, pixel by pixel in sensor order
+ * and stored as the capture would store it. The bar a pixel is in is stepped along
+ * with it rather than divided out; bar and within say where the line's first pixel is.
+ * UYVY pairs take their chroma from the first pixel of the pair in sensor order.
+ */
+static inline void imageTestPatternLine(const CAPTURE_CONFIGURATION *configuration, unsigned int lineBytes, unsigned int outputColumns,
+										unsigned int bar, unsigned int within, unsigned int inBlobRow, unsigned int blobColumn)
+{
+	const unsigned int barWidth = IMAGE_COLUMNS_IN_PIXELS / TEST_PATTERN_BARS;
+	const unsigned int decimation = configuration->decimation;
+	const unsigned int format = configuration->format;
+	const unsigned int forward = CAPTURE_COLUMNS_FORWARD(configuration->orientation);
+	const unsigned int bytesPerPixel = (format == CAPTURE_FORMAT_Y8) ? BYTES_PER_PIXEL_Y8 :
+										(format == CAPTURE_FORMAT_UYVY) ? BYTES_PER_PIXEL_UYUV : BYTES_PER_PIXEL_RGB;
+	unsigned char *l_pixel = (unsigned char *)lineBuffer + (forward ? 0 : lineBytes - bytesPerPixel);
+	const int step = forward ? (int)bytesPerPixel : -(int)bytesPerPixel;
+	unsigned int column = configuration->firstColumn;
+	unsigned char chroma = 0;
+
+	for(unsigned int columnCounter = 0; columnCounter < outputColumns; columnCounter++)
+	{
+		const unsigned int colour = (inBlobRow && column - blobColumn < barWidth) ? TEST_PATTERN_BARS : bar;
+		const unsigned char *bgr = testPatternBGR[colour];
+
+		if(format == CAPTURE_FORMAT_RGB)
+		{
+			l_pixel[0] = bgr[0];
+			l_pixel[1] = bgr[1];
+			l_pixel[2] = bgr[2];
+			if(segmenting) imageSegmentPixel(columnCounter, bgr[0], bgr[1], bgr[2]);
+		}
+		else if(format == CAPTURE_FORMAT_Y8)
+		{
+			l_pixel[0] = testPatternLuma[colour];
+		}
+		else
+		{
+			if(!(columnCounter & 1))
+			{
+				l_pixel[forward ? 0 : 1] = testPatternChroma[colour][0];
+				chroma = testPatternChroma[colour][1];
+			}
+			else
+			{
+				l_pixel[forward ? 0 : 1] = chroma;
+			}
+			l_pixel[forward ? 1 : 0] = testPatternLuma[colour];
+		}
+		l_pixel += step;
+
+		column += decimation;
+		within += decimation;
+		if(within >= barWidth)
+		{
+			within -= barWidth;
+			bar = (bar + 1) & (TEST_PATTERN_BARS - 1);
+		}
+	}
+}
 
+/*
+ * Draws the test pattern's next frame into imageData, as getImageGRB422Buffered would
+ * capture it, once the configured period has gone by since the last one began. The
+ * pattern moves with the frame count, so frames the host doesn't take aren't drawn.
+ */
+unsigned int getImageTestPattern(void)
+{
+	CAPTURE_CONFIGURATION configuration;
+	imageReadConfiguration(&configuration);
+	imageReadSegmentation(&configuration);
+
+	const unsigned int barWidth = IMAGE_COLUMNS_IN_PIXELS / TEST_PATTERN_BARS;
+	const unsigned int decimation = configuration.decimation;
+	const unsigned int outputRows = configuration.rows / decimation;
+	const unsigned int outputColumns = configuration.columns / decimation;
+	const unsigned int bytesPerPixel = (configuration.format == CAPTURE_FORMAT_Y8) ? BYTES_PER_PIXEL_Y8 :
+										(configuration.format == CAPTURE_FORMAT_UYVY) ? BYTES_PER_PIXEL_UYUV : BYTES_PER_PIXEL_RGB;
+	const unsigned int lineBytes = outputColumns * bytesPerPixel;
+	const int lineStep = CAPTURE_ROWS_FORWARD(configuration.orientation) ? (int)lineBytes : -(int)lineBytes;
+	unsigned char *l_DDRLine = (unsigned char *)imageData + (CAPTURE_ROWS_FORWARD(configuration.orientation) ? 0 : (outputRows - 1) * lineBytes);
+	const uint32_t frame = captureStatistics->frames;
+	const uint32_t patternPeriod = testPatternConfiguration->periodMicroseconds;
+	const uint32_t governorPeriod = captureGovernor->frameIntervalMicroseconds;
+	const uint32_t period = ((patternPeriod > governorPeriod) ? patternPeriod : governorPeriod) * PRU_CYCLES_PER_MICROSECOND;
+	uint32_t busWrites = 0;
+	uint32_t flushCycles = 0;
+
+	if(imageRestartCycleCounter()) testPatternStart = 0;
+	while(PRU1_CTRL.CYCLE - testPatternStart < period);
+	testPatternStart = PRU1_CTRL.CYCLE;
+	imageTestPatternColours();
+
+	unsigned int first = configuration.firstColumn + (frame * TEST_PATTERN_BAR_STEP) % IMAGE_COLUMNS_IN_PIXELS;
+	if(first >= IMAGE_COLUMNS_IN_PIXELS) first -= IMAGE_COLUMNS_IN_PIXELS;
+	const unsigned int bar = first / barWidth;
+	const unsigned int within = first - bar * barWidth;
+	const unsigned int blobColumn = TEST_PATTERN_BOUNCE(frame * TEST_PATTERN_BLOB_STEP_COLUMNS, IMAGE_COLUMNS_IN_PIXELS - barWidth);
+	const unsigned int blobRow = TEST_PATTERN_BOUNCE(frame * TEST_PATTERN_BLOB_STEP_ROWS, IMAGE_ROWS_IN_PIXELS - barWidth);
+	unsigned int row = configuration.firstRow;
+
+	for(unsigned int rowCounter = 0; rowCounter < outputRows; rowCounter++)
+	{
+		imageSegmentationStartLine(rowCounter);
+		imageTestPatternLine(&configuration, lineBytes, outputColumns, bar, within, row - blobRow < barWidth, blobColumn);
+		if(segmenting) imageSegmentationEndLine(outputColumns);
+		busWrites += imageCopyLine(l_DDRLine, lineBytes, &flushCycles);
+		l_DDRLine += lineStep;
+		row += decimation;
+	}
+
+	imageFinishFrame(&configuration, busWrites, flushCycles);
+	return 1;
+}
+
+unsigned int getImageFromSource(void)
+{
+	return testPatternConfiguration->enabled ? getImageTestPattern() : getImageGRB422Buffered();
+}
+
+/*
+ * Spins on frameTaken in shared RAM until the host is done with the last frame handed
+ * over. After an abandoned frame nothing is outstanding and it returns at once.
+ */
+void imageWaitForHost(void)
+{
+	if(!handedOver) return;
+
+	const uint32_t start = PRU1_CTRL.CYCLE;
+	while(!handshake->frameTaken);
+	handshake->waitCycles += PRU1_CTRL.CYCLE - start;
+	handshake->waits++;
+	handedOver = 0;
+}
+
+void imageHandOver(void)
+{
+	handshake->frameTaken = 0;
+	handedOver = 1;
+
+	/* what a pass of the old polling loop cost */
+	const uint32_t start = PRU1_CTRL.CYCLE;
+	(void)*imageReadyFlag;
+	handshake->carveoutReadCycles = PRU1_CTRL.CYCLE - start;
+
+	*imageReadyFlag = IMAGE_READY;
+}
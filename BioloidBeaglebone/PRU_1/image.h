@@ -16,12 +16,35 @@
 #define IMAGE_COLUMNS_IN_PIXELS_QVGA 	320
 #define IMAGE_ROWS_IN_PIXELS_VGA 		480
 #define IMAGE_COLUMNS_IN_PIXELS_VGA 	640
+#define BYTES_PER_PIXEL_Y8 				1
 #define BYTES_PER_PIXEL_UYUV 			2
 #define BYTES_PER_PIXEL_RGB 			3
 
-//Set resolution here
+/*
+ * The resolution is fixed when the firmware is built: 'make RESOLUTION=VGA' defines
+ * IMAGE_RESOLUTION_VGA and builds PRU_1_VGA.out, and the camera has to be set up to
+ * match (GRB422-VGA.sh). The firmware tells the host which it is through the
+ * carveout's captureSensor.
+ */
+#ifdef IMAGE_RESOLUTION_VGA
+#define IMAGE_ROWS_IN_PIXELS 			IMAGE_ROWS_IN_PIXELS_VGA
+#define IMAGE_COLUMNS_IN_PIXELS 		IMAGE_COLUMNS_IN_PIXELS_VGA
+#else
 #define IMAGE_ROWS_IN_PIXELS 			IMAGE_ROWS_IN_PIXELS_QVGA
 #define IMAGE_COLUMNS_IN_PIXELS 		IMAGE_COLUMNS_IN_PIXELS_QVGA
+#endif
+
+/*
+ * Segmenting a full resolution RGB capture classifies pixels between PCLKs, which at
+ * VGA leaves too little of a PCLK to be sure of, and its capture loops would take
+ * instruction RAM the VGA build is shorter of. So it is only built for QVGA; a VGA
+ * build segments decimated captures only, and the host thresholds the rest.
+ */
+#ifdef IMAGE_RESOLUTION_VGA
+#define IMAGE_SEGMENT_FULL_RESOLUTION	0
+#else
+#define IMAGE_SEGMENT_FULL_RESOLUTION	1
+#endif
 
 #define IMAGE_COLUMNS_IN_BYTES_UYUV		IMAGE_COLUMNS_IN_PIXELS * BYTES_PER_PIXEL_UYUV
 #define IMAGE_COLUMNS_IN_INTS_UYUV		IMAGE_COLUMNS_IN_BYTES_UYUV / sizeof(int)
@@ -33,9 +56,43 @@
 #define IMAGE_COLUMNS_IN_INTS			IMAGE_COLUMNS_IN_INTS_RGB
 #define BYTES_PER_PIXEL 				BYTES_PER_PIXEL_RGB
 
+/*
+ * The carveout's room for the image, in ints. The firmware only asks for what its
+ * resolution needs; the host's copy of the layout has room for the largest, so one
+ * host build works with either firmware (and replay can hold either), and never
+ * touches more of the carveout than captureSensor says is there.
+ */
+#ifdef __PRU__
+#define IMAGE_CARVEOUT_INTS				(IMAGE_ROWS_IN_PIXELS * IMAGE_COLUMNS_IN_PIXELS * BYTES_PER_PIXEL_RGB / sizeof(int))
+#else
+#define IMAGE_CARVEOUT_INTS				(IMAGE_ROWS_IN_PIXELS_VGA * IMAGE_COLUMNS_IN_PIXELS_VGA * BYTES_PER_PIXEL_RGB / sizeof(int))
+#endif
+
 #define INTS_PER_PASS_UYUV				1
 #define INTS_PER_PASS_RGB				3
-#define GET_IMAGE						getImageGRB422()
+#define GET_IMAGE						getImageFromSource()
+
+/*
+ * The buffered capture flushes each line to DDR in bursts this size. A line has to be
+ * a whole number of bursts (960 bytes is 30 at QVGA, 1920 is 60 at VGA).
+ */
+#define IMAGE_BURST_BYTES				32
+#define IMAGE_BURST_INTS				(IMAGE_BURST_BYTES / sizeof(int))
+#define IMAGE_COLUMNS_IN_BURSTS_RGB		(IMAGE_COLUMNS_IN_BYTES_RGB / IMAGE_BURST_BYTES)
+
+/*
+ * How long the waits hold out before giving up on the frame. PCLK runs all the time,
+ * so its wait is counted in passes round the polling loop (a few cycles each) rather
+ * than read from the cycle counter on every pixel; HREF and VSYNC are timed against
+ * the cycle counter (200 MHz). A line is short if HREF is high for fewer than the
+ * sensor's PCLKs less the slack.
+ */
+#define PCLK_TIMEOUT_SPINS				4096
+#define HREF_TIMEOUT_CYCLES				4000000
+#define VSYNC_TIMEOUT_CYCLES			40000000
+#define CYCLE_COUNTER_RESTART			0x80000000u
+#define SHORT_LINE_SLACK_PCLKS			8
+#define PRU_CYCLES_PER_MICROSECOND		200
 
 #define RED_5_BIT_MASK					0xF8
 #define GREEN_TOP_3_BIT_POSITION		5
@@ -66,6 +123,15 @@ typedef union
 	unsigned int asUInt;
 } YUVandIntUnion;
 
+/*
+ * Copying one of these is how the compiler is talked into a single multi-register
+ * LBBO/SBBO pair rather than a load and store per int.
+ */
+typedef struct
+{
+	unsigned int word[IMAGE_BURST_INTS];
+} IMAGE_BURST;
+
 extern inline void imageInitialize(void);
 extern inline void waitForPCLKRisingEdge(void);
 extern inline void waitForHREFRisingEdge(void);
@@ -74,5 +140,10 @@ extern inline void waitForVSYNCFallingEdge(void);
 extern inline void getImageUYUV(void);
 extern inline void getImageRGB565(void);
 extern inline void getImageGRB422(void);
+unsigned int getImageGRB422Buffered(void);
+unsigned int getImageTestPattern(void);
+unsigned int getImageFromSource(void);
+void imageWaitForHost(void);
+void imageHandOver(void);
 
 #endif /* IMAGE_H_ */
@@ -32,9 +32,9 @@ int main()
 
 	while(1)
 	{
-		while(*imageReadyFlag == IMAGE_READY);
-		GET_IMAGE;
-		*imageReadyFlag = IMAGE_READY;
+		imageWaitForHost();
+		if(!GET_IMAGE) continue;
+		imageHandOver();
 		LED_TOGGLE(PIN_NUMBER_FOR_LED_0);
 	}
 }
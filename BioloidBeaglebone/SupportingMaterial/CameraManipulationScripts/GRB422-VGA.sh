@@ -0,0 +1,2 @@
+i2cset -f -y 0x02 0x21 0x12 0x04
+sleep .5
\ No newline at end of file
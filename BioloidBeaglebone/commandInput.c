@@ -0,0 +1,165 @@
+/** @file commandInput.c
+ *  @brief Functions for reading commands without a window system.
+ *
+ *  stdin, the listening socket and the connected clients are all checked with a
+ *  single zero timeout poll() per call. Bytes read are queued so a client can send
+ *  several commands at once and have them handed out one per loop, the same way
+ *  keys would arrive from cvWaitKey.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "commandInput.h"
+
+static const char *commandSocketPath = NULL;
+static int commandSocket = -1;
+static int commandClients[COMMAND_INPUT_MAX_CLIENTS];
+static int commandClientCount = 0;
+static int commandStdinOpen = 1;
+
+static char commandBuffer[COMMAND_INPUT_BUFFER_SIZE];
+static int commandHead = 0;
+static int commandTail = 0;
+
+int commandInputInitialize(const char *socketPath)
+{
+	struct sockaddr_un address;
+
+	commandClientCount = 0;
+	commandStdinOpen = 1;
+	commandHead = commandTail = 0;
+	if(socketPath == NULL) return 0;
+
+	if(strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "Control socket path %s is too long\n", socketPath);
+		return -1;
+	}
+
+	commandSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if(commandSocket < 0) return -1;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+	unlink(socketPath);
+
+	if(bind(commandSocket, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(commandSocket, COMMAND_INPUT_MAX_CLIENTS) != 0)
+	{
+		fprintf(stderr, "Could not create control socket %s\n", socketPath);
+		close(commandSocket);
+		commandSocket = -1;
+		return -1;
+	}
+
+	commandSocketPath = socketPath;
+	printf("Listening for commands on %s\n", socketPath);
+	return 0;
+}
+
+static void commandInputQueue(const char *bytes, int count)
+{
+	for(int i = 0; i < count; i++)
+	{
+		if(isspace((unsigned char)bytes[i])) continue;
+		if(commandHead - commandTail == COMMAND_INPUT_BUFFER_SIZE) return;
+		commandBuffer[commandHead % COMMAND_INPUT_BUFFER_SIZE] = bytes[i];
+		commandHead++;
+	}
+}
+
+/*
+ * Reads what's waiting on a descriptor poll() flagged. Returns 0 once the other end
+ * has gone away.
+ */
+static int commandInputDrain(int descriptor)
+{
+	char bytes[COMMAND_INPUT_BUFFER_SIZE];
+
+	int count = read(descriptor, bytes, sizeof(bytes));
+	if(count <= 0) return 0;
+	commandInputQueue(bytes, count);
+	return 1;
+}
+
+char commandInputRead()
+{
+	struct pollfd descriptors[COMMAND_INPUT_MAX_CLIENTS + 2];
+	int descriptorCount = 0;
+	int client = 0;
+
+	if(commandTail != commandHead) return commandBuffer[(commandTail++) % COMMAND_INPUT_BUFFER_SIZE];
+
+	if(commandStdinOpen)
+	{
+		descriptors[descriptorCount].fd = STDIN_FILENO;
+		descriptors[descriptorCount++].events = POLLIN;
+	}
+	if(commandSocket >= 0)
+	{
+		descriptors[descriptorCount].fd = commandSocket;
+		descriptors[descriptorCount++].events = POLLIN;
+	}
+	for(client = 0; client < commandClientCount; client++)
+	{
+		descriptors[descriptorCount].fd = commandClients[client];
+		descriptors[descriptorCount++].events = POLLIN;
+	}
+
+	if(descriptorCount == 0 || poll(descriptors, descriptorCount, 0) <= 0) return 0;
+
+	for(int i = 0; i < descriptorCount; i++)
+	{
+		if(descriptors[i].revents == 0) continue;
+
+		if(descriptors[i].fd == STDIN_FILENO)
+		{
+			commandStdinOpen = commandInputDrain(STDIN_FILENO);
+		}
+		else if(descriptors[i].fd == commandSocket)
+		{
+			int accepted = accept(commandSocket, NULL, NULL);
+			if(accepted < 0) continue;
+			if(commandClientCount == COMMAND_INPUT_MAX_CLIENTS)
+			{
+				close(accepted);
+				continue;
+			}
+			commandClients[commandClientCount++] = accepted;
+		}
+		else if(!commandInputDrain(descriptors[i].fd))
+		{
+			for(client = 0; commandClients[client] != descriptors[i].fd; client++);
+			close(commandClients[client]);
+			commandClients[client] = commandClients[--commandClientCount];
+		}
+	}
+
+	if(commandTail != commandHead) return commandBuffer[(commandTail++) % COMMAND_INPUT_BUFFER_SIZE];
+	return 0;
+}
+
+void commandInputUninitialize()
+{
+	for(int client = 0; client < commandClientCount; client++) close(commandClients[client]);
+	commandClientCount = 0;
+
+	if(commandSocket >= 0) close(commandSocket);
+	commandSocket = -1;
+
+	if(commandSocketPath != NULL) unlink(commandSocketPath);
+	commandSocketPath = NULL;
+}
@@ -0,0 +1,53 @@
+/** @file commandInput.h
+ *  @brief Function prototypes for reading commands without a window system.
+ *
+ *  These are the prototypes for functions that: open a local (Unix domain) control
+ *  socket, and read the single character commands the main loop understands from
+ *  stdin and from any client connected to that socket, without blocking. In headless
+ *  mode this takes the place of cvWaitKey, which needs a HighGUI window to read keys.
+ *  Whitespace is ignored, so 'echo c | socat - UNIX-CONNECT:socket' or typing 'c' and
+ *  enter both select Caffe.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef COMMANDINPUT_H_
+#define COMMANDINPUT_H_
+
+#define COMMAND_INPUT_MAX_CLIENTS		4
+#define COMMAND_INPUT_BUFFER_SIZE		64
+
+/** @brief Starts listening for commands
+ *
+ * 	Commands are always read from stdin (until it reaches end of file). If a socket
+ * 	path is given, a listening socket is created there too; any stale socket file left
+ * 	by a previous run is removed first.
+ *
+ *	@param	socketPath where to create the control socket, or NULL for stdin only.
+ * 	@return 0 on success, -1 if the socket couldn't be created.
+ *
+ */
+int commandInputInitialize(const char *socketPath);
+
+/** @brief Gets the next command, if there is one
+ *
+ * 	Accepts any new socket clients and reads whatever is waiting on stdin and the
+ * 	clients, but never waits for input.
+ *
+ * 	@return the next command character, or 0 if there is none.
+ *
+ */
+char commandInputRead();
+
+/** @brief Closes the clients and the socket and removes the socket file
+ *
+ * 	@return void.
+ *
+ */
+void commandInputUninitialize();
+
+#endif /* COMMANDINPUT_H_ */
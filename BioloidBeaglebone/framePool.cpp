@@ -0,0 +1,65 @@
+/** @file framePool.cpp
+ *  @brief Functions for a pool of reference counted frame buffers.
+ *
+ *  The pool is small and fixed, so finding a free buffer is a scan for a zero
+ *  reference count claimed with a compare and swap; no locks and no allocation after
+ *  framePoolInitialize.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include "framePool.hpp"
+
+using namespace std;
+using namespace cv;
+
+static FRAME_POOL_FRAME framePool[FRAME_POOL_SIZE];
+static atomic<uint64_t> framePoolSequence(0);
+static atomic<uint64_t> framePoolMisses(0);
+
+void framePoolInitialize(Size frameSize, int type)
+{
+	for(int i = 0; i < FRAME_POOL_SIZE; i++)
+	{
+		framePool[i].image.create(frameSize, type);
+		framePool[i].timestamp = 0;
+		framePool[i].sequence = 0;
+		framePool[i].references = 0;
+	}
+}
+
+FRAME_POOL_FRAME *framePoolAcquire()
+{
+	for(int i = 0; i < FRAME_POOL_SIZE; i++)
+	{
+		int free = 0;
+		if(framePool[i].references.compare_exchange_strong(free, 1))
+		{
+			framePool[i].sequence = framePoolSequence++;
+			return &framePool[i];
+		}
+	}
+	framePoolMisses++;
+	return NULL;
+}
+
+FRAME_POOL_FRAME *framePoolRetain(FRAME_POOL_FRAME *frame)
+{
+	frame->references++;
+	return frame;
+}
+
+void framePoolRelease(FRAME_POOL_FRAME *frame)
+{
+	if(frame == NULL) return;
+	frame->references--;
+}
+
+uint64_t framePoolExhausted()
+{
+	return framePoolMisses;
+}
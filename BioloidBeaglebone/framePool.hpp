@@ -0,0 +1,73 @@
+/** @file framePool.hpp
+ *  @brief Function prototypes for a pool of reference counted frame buffers.
+ *
+ *  These are the prototypes for functions that: allocate a handful of frame buffers
+ *  once, hand them out with a reference count of one, let anything that wants to keep
+ *  a frame past the current loop take another reference, and return a buffer to the
+ *  pool when its last reference is released. A frame from the pool is ordinary cached
+ *  memory that nothing else writes to, unlike the PRU carveout, so it can be
+ *  processed, drawn on and displayed in place.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef FRAMEPOOL_HPP_
+#define FRAMEPOOL_HPP_
+
+#include <stdint.h>
+#include <atomic>
+#include "opencv2/core.hpp"
+
+#define FRAME_POOL_SIZE					4
+
+typedef struct{
+	cv::Mat image;
+	uint64_t timestamp;
+	uint64_t sequence;
+	std::atomic<int> references;
+} FRAME_POOL_FRAME;
+
+/** @brief Allocates every buffer in the pool
+ *
+ *	@param	frameSize the size of the frames.
+ *	@param	type the OpenCV type of the frames.
+ * 	@return void.
+ *
+ */
+void framePoolInitialize(cv::Size frameSize, int type);
+
+/** @brief Takes a free buffer from the pool
+ *
+ * 	@return a frame with one reference, or NULL if every buffer is in use.
+ *
+ */
+FRAME_POOL_FRAME *framePoolAcquire();
+
+/** @brief Takes another reference to a frame
+ *
+ *	@param	frame the frame to keep.
+ * 	@return the same frame.
+ *
+ */
+FRAME_POOL_FRAME *framePoolRetain(FRAME_POOL_FRAME *frame);
+
+/** @brief Drops a reference, returning the buffer to the pool if it was the last
+ *
+ *	@param	frame the frame to release. NULL is ignored.
+ * 	@return void.
+ *
+ */
+void framePoolRelease(FRAME_POOL_FRAME *frame);
+
+/** @brief Counts the frames that couldn't be handed out because the pool was empty
+ *
+ * 	@return the number of failed framePoolAcquire calls.
+ *
+ */
+uint64_t framePoolExhausted();
+
+#endif /* FRAMEPOOL_HPP_ */
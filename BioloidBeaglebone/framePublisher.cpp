@@ -0,0 +1,213 @@
+/** @file framePublisher.cpp
+ *  @brief Functions for publishing frames and results into shared memory.
+ *
+ *  The only work this adds to the vision loop is one copy of the frame out of the PRU
+ *  carveout (which the PRU reuses as soon as we release it) and a few hundred bytes of
+ *  results per frame. The slot being written is never the latest one, so readers are
+ *  only ever turned away from a slot when they have held on to it for a whole trip
+ *  round the ring.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "framePublisher.hpp"
+
+static const char *publisherName = NULL;
+static unsigned char *publisherMap = NULL;
+static size_t publisherMapBytes = 0;
+static FRAME_PUBLISHER_HEADER *publisherHeader = NULL;
+static FRAME_PUBLISHER_SLOT *publisherSlot = NULL;
+
+static FRAME_PUBLISHER_SLOT *framePublisherSlot(const FRAME_PUBLISHER_HEADER *header, uint64_t frameNumber)
+{
+	unsigned char *base = (unsigned char *)header + FRAME_PUBLISHER_PAGE_SIZE;
+	return (FRAME_PUBLISHER_SLOT *)(base + (frameNumber % header->slotCount) * header->slotBytes);
+}
+
+int framePublisherStart(const char *name, int width, int height, int type, uint32_t frameBytes)
+{
+	const uint32_t frameOffset = (sizeof(FRAME_PUBLISHER_SLOT) + FRAME_PUBLISHER_PAGE_SIZE - 1) & ~(FRAME_PUBLISHER_PAGE_SIZE - 1);
+	const uint64_t slotBytes = (frameOffset + frameBytes + FRAME_PUBLISHER_PAGE_SIZE - 1) & ~(uint64_t)(FRAME_PUBLISHER_PAGE_SIZE - 1);
+
+	int file = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(file < 0)
+	{
+		fprintf(stderr, "Could not create shared memory %s\n", name);
+		return -1;
+	}
+
+	publisherMapBytes = FRAME_PUBLISHER_PAGE_SIZE + FRAME_PUBLISHER_SLOTS * slotBytes;
+	if(ftruncate(file, publisherMapBytes) != 0)
+	{
+		close(file);
+		shm_unlink(name);
+		return -1;
+	}
+	publisherMap = (unsigned char *)mmap(NULL, publisherMapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if(publisherMap == MAP_FAILED)
+	{
+		publisherMap = NULL;
+		shm_unlink(name);
+		return -1;
+	}
+
+	/* The magic goes in last, so a reader that attaches early never sees a half made header. */
+	publisherHeader = (FRAME_PUBLISHER_HEADER *)publisherMap;
+	publisherHeader->version = FRAME_PUBLISHER_VERSION;
+	publisherHeader->width = width;
+	publisherHeader->height = height;
+	publisherHeader->type = type;
+	publisherHeader->frameBytes = frameBytes;
+	publisherHeader->slotCount = FRAME_PUBLISHER_SLOTS;
+	publisherHeader->frameOffset = frameOffset;
+	publisherHeader->slotBytes = slotBytes;
+	publisherHeader->latest = 0;
+	publisherHeader->published = 0;
+	__sync_synchronize();
+	publisherHeader->magic = FRAME_PUBLISHER_MAGIC;
+
+	publisherName = name;
+	printf("Publishing frames to shared memory %s\n", name);
+	return 0;
+}
+
+void framePublisherBegin(const void *frame, uint64_t timestamp)
+{
+	if(publisherHeader == NULL) return;
+
+	const uint64_t frameNumber = publisherHeader->published;
+	publisherSlot = framePublisherSlot(publisherHeader, frameNumber);
+
+	publisherSlot->sequence++;
+	__sync_synchronize();
+
+	publisherSlot->frameNumber = frameNumber;
+	publisherSlot->timestamp = timestamp;
+	publisherSlot->tasks = 0;
+	publisherSlot->budgetMilliseconds = 0;
+	publisherSlot->usedMilliseconds = 0;
+	publisherSlot->slackMilliseconds = 0;
+	memcpy((unsigned char *)publisherSlot + publisherHeader->frameOffset, frame, publisherHeader->frameBytes);
+}
+
+void framePublisherSchedule(uint32_t tasks, float budgetMilliseconds, float usedMilliseconds, float slackMilliseconds)
+{
+	if(publisherSlot == NULL) return;
+
+	publisherSlot->tasks = tasks;
+	publisherSlot->budgetMilliseconds = budgetMilliseconds;
+	publisherSlot->usedMilliseconds = usedMilliseconds;
+	publisherSlot->slackMilliseconds = slackMilliseconds;
+}
+
+void framePublisherEnd(FRAME_PUBLISHER_MODE mode, const VISION_DETECTIONS *detections, double blobArea, int blobX, int blobY)
+{
+	if(publisherSlot == NULL) return;
+
+	publisherSlot->mode = mode;
+	publisherSlot->blobArea = blobArea;
+	publisherSlot->blobX = blobX;
+	publisherSlot->blobY = blobY;
+	publisherSlot->detectionCount = 0;
+	publisherSlot->detectionsDropped = 0;
+
+	for(int i = 0; detections != NULL && i < detections->keptCount; i++)
+	{
+		if(publisherSlot->detectionCount == FRAME_PUBLISHER_MAX_DETECTIONS)
+		{
+			publisherSlot->detectionsDropped++;
+			continue;
+		}
+		const int idx = detections->kept[i];
+		FRAME_PUBLISHER_DETECTION *detection = &(publisherSlot->detections[publisherSlot->detectionCount++]);
+		detection->x = detections->box[idx].x;
+		detection->y = detections->box[idx].y;
+		detection->width = detections->box[idx].width;
+		detection->height = detections->box[idx].height;
+		detection->classId = detections->classId[idx];
+		detection->confidence = detections->confidence[idx];
+	}
+
+	__sync_synchronize();
+	publisherSlot->sequence++;
+	__sync_synchronize();
+	publisherHeader->latest = publisherSlot->frameNumber;
+	publisherHeader->published = publisherSlot->frameNumber + 1;
+	publisherSlot = NULL;
+}
+
+uint64_t framePublisherCount(void)
+{
+	return (publisherHeader != NULL) ? publisherHeader->published : 0;
+}
+
+void framePublisherStop(void)
+{
+	if(publisherMap == NULL) return;
+
+	munmap(publisherMap, publisherMapBytes);
+	shm_unlink(publisherName);
+	publisherMap = NULL;
+	publisherHeader = NULL;
+	publisherSlot = NULL;
+	publisherName = NULL;
+}
+
+const FRAME_PUBLISHER_HEADER *framePublisherAttach(const char *name)
+{
+	struct stat fileStatus;
+
+	int file = shm_open(name, O_RDONLY, 0);
+	if(file < 0) return NULL;
+	if(fstat(file, &fileStatus) != 0 || (size_t)fileStatus.st_size < FRAME_PUBLISHER_PAGE_SIZE)
+	{
+		close(file);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if(map == MAP_FAILED) return NULL;
+
+	const FRAME_PUBLISHER_HEADER *header = (const FRAME_PUBLISHER_HEADER *)map;
+	if(header->magic != FRAME_PUBLISHER_MAGIC || header->version != FRAME_PUBLISHER_VERSION)
+	{
+		munmap(map, fileStatus.st_size);
+		return NULL;
+	}
+	return header;
+}
+
+uint32_t framePublisherReadBegin(const FRAME_PUBLISHER_HEADER *header, const FRAME_PUBLISHER_SLOT **slot, const unsigned char **frame)
+{
+	while(header->published != 0)
+	{
+		*slot = framePublisherSlot(header, header->latest);
+		uint32_t sequence = (*slot)->sequence;
+		__sync_synchronize();
+
+		/* Odd means the publisher lapped us and is rewriting it; latest will have moved on. */
+		if(sequence & 1) continue;
+
+		*frame = (const unsigned char *)(*slot) + header->frameOffset;
+		return sequence;
+	}
+	return 0;
+}
+
+int framePublisherReadValid(const FRAME_PUBLISHER_SLOT *slot, uint32_t sequence)
+{
+	__sync_synchronize();
+	return slot->sequence == sequence;
+}
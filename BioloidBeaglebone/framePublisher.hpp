@@ -0,0 +1,196 @@
+/** @file framePublisher.hpp
+ *  @brief Shared memory layout and function prototypes for publishing frames.
+ *
+ *  These are the layout of, and the prototypes for functions that: create a POSIX
+ *  shared memory ring that the vision manager publishes each processed frame and its
+ *  results (detections or threshold blob) into, and let other local processes map the
+ *  ring read only and read the latest frame in place.
+ *
+ *  The ring is a FRAME_PUBLISHER_HEADER page followed by FRAME_PUBLISHER_SLOTS page
+ *  aligned slots, each a FRAME_PUBLISHER_SLOT followed by the raw frame. Every slot is
+ *  guarded by a seqlock: its sequence is odd while the publisher is writing it and is
+ *  bumped to the next even value when it is done, after which the header's latest
+ *  field is pointed at it. A reader notes the (even) sequence, uses the slot where it
+ *  is, and then checks the sequence hasn't moved; if it has, the slot was reused under
+ *  it and it should just try the latest one again. The publisher never waits for
+ *  readers, and there is no limit on how many there are.
+ *
+ *  Everything in the shared memory is plain C so tools in other languages can map it.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef FRAMEPUBLISHER_HPP_
+#define FRAMEPUBLISHER_HPP_
+
+#include <stdint.h>
+
+#define FRAME_PUBLISHER_DEFAULT_NAME		"/bioloidVision"
+#define FRAME_PUBLISHER_MAGIC				0x50564242	/* "BBVP" */
+#define FRAME_PUBLISHER_VERSION				2
+#define FRAME_PUBLISHER_SLOTS				4
+#define FRAME_PUBLISHER_MAX_DETECTIONS		32
+#define FRAME_PUBLISHER_PAGE_SIZE			4096
+
+typedef enum{
+	FRAME_PUBLISHER_MODE_NONE,
+	FRAME_PUBLISHER_MODE_THRESHOLD,
+	FRAME_PUBLISHER_MODE_CAFFE,
+	FRAME_PUBLISHER_MODE_DARKNET,
+	FRAME_PUBLISHER_MODE_SCHEDULED
+} FRAME_PUBLISHER_MODE;
+
+typedef struct{
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	int32_t classId;
+	float confidence;
+} FRAME_PUBLISHER_DETECTION;
+
+typedef struct{
+	volatile uint32_t sequence;
+	uint32_t mode;
+	uint64_t frameNumber;
+	uint64_t timestamp;
+	double blobArea;
+	int32_t blobX;
+	int32_t blobY;
+	uint32_t detectionCount;
+	uint32_t detectionsDropped;
+	uint32_t tasks;
+	float budgetMilliseconds;
+	float usedMilliseconds;
+	float slackMilliseconds;
+	FRAME_PUBLISHER_DETECTION detections[FRAME_PUBLISHER_MAX_DETECTIONS];
+} FRAME_PUBLISHER_SLOT;
+
+typedef struct{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t type;
+	uint32_t frameBytes;
+	uint32_t slotCount;
+	uint32_t frameOffset;
+	uint64_t slotBytes;
+	volatile uint64_t latest;
+	volatile uint64_t published;
+} FRAME_PUBLISHER_HEADER;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Creates the shared memory ring
+ *
+ *	@param	name the POSIX shared memory name (starting with '/').
+ *	@param	width the frame width in pixels.
+ *	@param	height the frame height in pixels.
+ *	@param	type the OpenCV type of the frame.
+ *	@param	frameBytes the size of one frame in bytes.
+ * 	@return 0 on success, -1 if the shared memory couldn't be created.
+ *
+ */
+int framePublisherStart(const char *name, int width, int height, int type, uint32_t frameBytes);
+
+/** @brief Starts publishing a frame
+ *
+ *	Copies the frame, as it came from the PRU and before anything is drawn on it, into
+ *	the next slot and leaves the slot marked as being written. Readers keep seeing the
+ *	previous frame until framePublisherEnd.
+ *
+ *	@param	frame the raw frame bytes.
+ *	@param	timestamp when the frame arrived, from frameRecordingNow.
+ * 	@return void.
+ *
+ */
+void framePublisherBegin(const void *frame, uint64_t timestamp);
+
+/** @brief Records how the frame's processing time was spent
+ *
+ *	Call between framePublisherBegin and framePublisherEnd. Frames it isn't called for
+ *	are published with no tasks and zero times.
+ *
+ *	@param	tasks the tasks that ran on the frame, as VISION_TASK_BIT flags.
+ *	@param	budgetMilliseconds the scheduler's per-frame budget, or 0 if not scheduled.
+ *	@param	usedMilliseconds the processing time the frame used.
+ *	@param	slackMilliseconds the budget left over (negative when over), or 0 if not scheduled.
+ * 	@return void.
+ *
+ */
+void framePublisherSchedule(uint32_t tasks, float budgetMilliseconds, float usedMilliseconds, float slackMilliseconds);
+
+/** @brief Gets the published frame count
+ *
+ * 	@return the number of frames published so far.
+ *
+ */
+uint64_t framePublisherCount(void);
+
+/** @brief Removes the shared memory ring
+ *
+ * 	Readers that still have it mapped keep their mapping; new ones can't attach.
+ *
+ * 	@return void.
+ *
+ */
+void framePublisherStop(void);
+
+/** @brief Maps a published ring read only, for use by other processes
+ *
+ *	@param	name the POSIX shared memory name the publisher was started with.
+ * 	@return the ring's header, or NULL if there is no such ring or it isn't one.
+ *
+ */
+const FRAME_PUBLISHER_HEADER *framePublisherAttach(const char *name);
+
+/** @brief Finds the latest complete frame and notes its sequence
+ *
+ *	@param	header the attached ring.
+ *	@param	slot set to the latest slot.
+ *	@param	frame set to the slot's frame bytes.
+ * 	@return the sequence to pass to framePublisherReadValid, or 0 if nothing has been
+ * 			published yet.
+ *
+ */
+uint32_t framePublisherReadBegin(const FRAME_PUBLISHER_HEADER *header, const FRAME_PUBLISHER_SLOT **slot, const unsigned char **frame);
+
+/** @brief Checks that a slot wasn't reused while it was being read
+ *
+ *	@param	slot the slot from framePublisherReadBegin.
+ *	@param	sequence the sequence from framePublisherReadBegin.
+ * 	@return non-zero if everything read from the slot since framePublisherReadBegin is good.
+ *
+ */
+int framePublisherReadValid(const FRAME_PUBLISHER_SLOT *slot, uint32_t sequence);
+
+#ifdef __cplusplus
+}
+
+#include "visionDetections.hpp"
+
+/** @brief Finishes publishing a frame with its results
+ *
+ *	Fills in the results for the frame started with framePublisherBegin, marks the slot
+ *	complete and makes it the latest.
+ *
+ *	@param	mode which processing produced the results.
+ *	@param	detections the kept detections, or NULL if the mode has none.
+ *	@param	blobArea the threshold blob's area (m00), or 0.
+ *	@param	blobX the threshold blob's centroid x.
+ *	@param	blobY the threshold blob's centroid y.
+ * 	@return void.
+ *
+ */
+void framePublisherEnd(FRAME_PUBLISHER_MODE mode, const VISION_DETECTIONS *detections, double blobArea, int blobX, int blobY);
+
+#endif
+
+#endif /* FRAMEPUBLISHER_HPP_ */
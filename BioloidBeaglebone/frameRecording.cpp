@@ -0,0 +1,574 @@
+/** @file frameRecording.cpp
+ *  @brief Functions for recording frames to a file and replaying them.
+ *
+ *  The recorder keeps a small queue of file slot sized, page aligned buffers. The
+ *  vision loop copies a frame into the next free one and moves on; a writer thread
+ *  pwrite()s each filled buffer to its place in the file, so the vision loop never
+ *  waits on the disk. The replayer stands in for PRU1: it owns a PRU_INTEROP_1_DATA
+ *  in ordinary memory and follows the same image ready flag handshake. The test pattern
+ *  producer is a replayer whose frames are drawn rather than read.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include "frameRecording.hpp"
+
+extern "C"
+{
+#include "PRUInterop.h"
+#include "pru.h"
+}
+
+using namespace std;
+
+static int recorderFile = -1;
+static FRAME_RECORDING_HEADER recorderHeader;
+static unsigned char *recorderQueue = NULL;
+static unsigned int recorderHead = 0;
+static unsigned int recorderTail = 0;
+static bool recorderStopping = false;
+static uint64_t recorderSequence = 0;
+static uint64_t recorderDropped = 0;
+static vector<FRAME_RECORDING_INDEX> recorderIndex;
+static mutex recorderLock;
+static condition_variable recorderSignal;
+static thread recorderThread;
+
+static unsigned char *replayMap = NULL;
+static size_t replayMapBytes = 0;
+static const FRAME_RECORDING_HEADER *replayHeader = NULL;
+static PRU_INTEROP_1_DATA *replayInterop = NULL;
+static thread replayThread;
+static atomic<bool> replayStopping(false);
+static atomic<bool> replayDone(false);
+static FRAME_RECORDING_HEADER testPatternHeader;
+
+uint64_t frameRecordingNow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void frameRecorderRun(void)
+{
+	unique_lock<mutex> lock(recorderLock);
+
+	while(true)
+	{
+		recorderSignal.wait(lock, []{ return recorderTail != recorderHead || recorderStopping; });
+		if(recorderTail == recorderHead) break;
+
+		unsigned char *slot = recorderQueue + (recorderTail % FRAME_RECORDING_QUEUE_LENGTH) * recorderHeader.slotBytes;
+		lock.unlock();
+
+		FRAME_RECORDING_INDEX entry;
+		entry.offset = FRAME_RECORDING_PAGE_SIZE + recorderIndex.size() * recorderHeader.slotBytes;
+		entry.timestamp = ((FRAME_RECORDING_SLOT *)slot)->timestamp;
+		if(pwrite(recorderFile, slot, recorderHeader.slotBytes, entry.offset) == (ssize_t)recorderHeader.slotBytes)
+		{
+			recorderIndex.push_back(entry);
+		}
+
+		lock.lock();
+		recorderTail++;
+	}
+}
+
+int frameRecorderStart(const char *filename, int width, int height, int type, uint32_t frameBytes, uint32_t orientation)
+{
+	recorderFile = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(recorderFile < 0)
+	{
+		fprintf(stderr, "Could not create recording %s\n", filename);
+		return -1;
+	}
+
+	memset(&recorderHeader, 0, sizeof(recorderHeader));
+	recorderHeader.magic = FRAME_RECORDING_MAGIC;
+	recorderHeader.version = FRAME_RECORDING_VERSION;
+	recorderHeader.width = width;
+	recorderHeader.height = height;
+	recorderHeader.type = type;
+	recorderHeader.frameBytes = frameBytes;
+	recorderHeader.orientation = orientation;
+	recorderHeader.slotBytes = (FRAME_RECORDING_SLOT_HEADER_SIZE + frameBytes + FRAME_RECORDING_PAGE_SIZE - 1) & ~(uint64_t)(FRAME_RECORDING_PAGE_SIZE - 1);
+	pwrite(recorderFile, &recorderHeader, sizeof(recorderHeader), 0);
+
+	if(posix_memalign((void **)&recorderQueue, FRAME_RECORDING_PAGE_SIZE, FRAME_RECORDING_QUEUE_LENGTH * recorderHeader.slotBytes) != 0)
+	{
+		close(recorderFile);
+		recorderFile = -1;
+		return -1;
+	}
+	memset(recorderQueue, 0, FRAME_RECORDING_QUEUE_LENGTH * recorderHeader.slotBytes);
+
+	recorderHead = recorderTail = 0;
+	recorderSequence = recorderDropped = 0;
+	recorderStopping = false;
+	recorderIndex.clear();
+	recorderIndex.reserve(1024);
+	recorderThread = thread(frameRecorderRun);
+
+	printf("Recording frames to %s\n", filename);
+	return 0;
+}
+
+void frameRecorderWrite(const void *frame, uint64_t timestamp)
+{
+	if(recorderFile < 0) return;
+
+	recorderLock.lock();
+	if(recorderHead - recorderTail == FRAME_RECORDING_QUEUE_LENGTH)
+	{
+		recorderDropped++;
+		recorderSequence++;
+		recorderLock.unlock();
+		return;
+	}
+	unsigned char *slot = recorderQueue + (recorderHead % FRAME_RECORDING_QUEUE_LENGTH) * recorderHeader.slotBytes;
+	recorderLock.unlock();
+
+	FRAME_RECORDING_SLOT *slotHeader = (FRAME_RECORDING_SLOT *)slot;
+	slotHeader->sequence = recorderSequence++;
+	slotHeader->timestamp = timestamp;
+	memcpy(slot + FRAME_RECORDING_SLOT_HEADER_SIZE, frame, recorderHeader.frameBytes);
+
+	recorderLock.lock();
+	recorderHead++;
+	recorderLock.unlock();
+	recorderSignal.notify_one();
+}
+
+void frameRecorderStop(void)
+{
+	if(recorderFile < 0) return;
+
+	recorderLock.lock();
+	recorderStopping = true;
+	recorderLock.unlock();
+	recorderSignal.notify_one();
+	recorderThread.join();
+
+	recorderHeader.frameCount = recorderIndex.size();
+	recorderHeader.indexOffset = FRAME_RECORDING_PAGE_SIZE + recorderHeader.frameCount * recorderHeader.slotBytes;
+	pwrite(recorderFile, recorderIndex.data(), recorderIndex.size() * sizeof(FRAME_RECORDING_INDEX), recorderHeader.indexOffset);
+	pwrite(recorderFile, &recorderHeader, sizeof(recorderHeader), 0);
+	close(recorderFile);
+	recorderFile = -1;
+
+	free(recorderQueue);
+	recorderQueue = NULL;
+
+	printf("Recorded %llu frames, dropped %llu\n", (unsigned long long)recorderHeader.frameCount, (unsigned long long)recorderDropped);
+}
+
+static uint64_t frameReplayFrameCount(void)
+{
+	if(replayHeader->frameCount > 0) return replayHeader->frameCount;
+
+	/* No index, the recorder didn't get to close the file. Use every whole slot. */
+	return (replayMapBytes - FRAME_RECORDING_PAGE_SIZE) / replayHeader->slotBytes;
+}
+
+static const unsigned char *frameReplaySlot(uint64_t frame)
+{
+	if(replayHeader->indexOffset != 0)
+	{
+		const FRAME_RECORDING_INDEX *index = (const FRAME_RECORDING_INDEX *)(replayMap + replayHeader->indexOffset);
+		return replayMap + index[frame].offset;
+	}
+	return replayMap + FRAME_RECORDING_PAGE_SIZE + frame * replayHeader->slotBytes;
+}
+
+/*
+ * Recordings hold whole BGR frames (in the orientation their header gives), so the
+ * window, decimation, format and orientation the vision manager asks PRU1 for are
+ * applied here as PRU1 would: the same validation, and the window packed at the start
+ * of imageData. Luma is BT.601, as the camera's YUV mode gives it; UYVY pairs take
+ * their chroma from the pair's first pixel in sensor order.
+ */
+static unsigned char frameReplayLuma(const unsigned char *bgr)
+{
+	return (29 * bgr[0] + 150 * bgr[1] + 77 * bgr[2]) >> 8;
+}
+
+/*
+ * BT.601 U (from channel 0, blue) or V (channel 2, red), offset to 128.
+ */
+static unsigned char frameReplayChroma(const unsigned char *bgr, int channel)
+{
+	int chroma = ((bgr[channel] - frameReplayLuma(bgr)) * ((channel == 0) ? 144 : 182) >> 8) + 128;
+	return (unsigned char)min(max(chroma, 0), 255);
+}
+
+/*
+ * PRU1's segmentation, over the image just put in imageData: runs and moments in the
+ * stored image's pixels but sensor order, the runs past SEGMENTATION_MAX_RUNS only
+ * counted.
+ */
+static void frameReplaySegment(const CAPTURE_CONFIGURATION &configuration)
+{
+	const SEGMENTATION_CONFIGURATION &box = replayInterop->segmentationConfiguration;
+	SEGMENTATION_RESULT *result = &(replayInterop->segmentationResult);
+	const unsigned int columns = configuration.columns / configuration.decimation;
+	const unsigned int rows = configuration.rows / configuration.decimation;
+	const unsigned char *image = (const unsigned char *)replayInterop->imageData;
+	const bool columnsForward = CAPTURE_COLUMNS_FORWARD(configuration.orientation);
+	const bool rowsForward = CAPTURE_ROWS_FORWARD(configuration.orientation);
+
+	result->frame = 0;
+	result->m00 = 0;
+	result->m10 = 0;
+	result->m01 = 0;
+	result->runCount = 0;
+	result->runsDropped = 0;
+	if(!box.enabled || configuration.format != CAPTURE_FORMAT_RGB) return;
+
+	for(unsigned int row = 0; row < rows; row++)
+	{
+		unsigned int start = 0;
+		bool inRun = false;
+		for(unsigned int column = 0; column <= columns; column++)
+		{
+			bool match = false;
+			if(column < columns)
+			{
+				unsigned int storedRow = rowsForward ? row : rows - 1 - row;
+				unsigned int storedColumn = columnsForward ? column : columns - 1 - column;
+				const unsigned char *pixel = image + (storedRow * columns + storedColumn) * BYTES_PER_PIXEL_RGB;
+				match = true;
+				for(int channel = 0; channel < 3; channel++) match = match && pixel[channel] >= box.low[channel] && pixel[channel] <= box.high[channel];
+			}
+			if(match == inRun) continue;
+			inRun = match;
+			if(match)
+			{
+				start = column;
+				continue;
+			}
+
+			const unsigned int length = column - start;
+			result->m00 += length;
+			result->m10 += ((start + column - 1) * length) >> 1;
+			result->m01 += row * length;
+			if(result->runCount < SEGMENTATION_MAX_RUNS)
+			{
+				SEGMENTATION_RUN *run = &(result->runs[result->runCount++]);
+				run->row = row;
+				run->start = start;
+				run->end = column;
+			}
+			else
+			{
+				result->runsDropped++;
+			}
+		}
+	}
+	result->frame = replayInterop->captureStatistics.frames;
+}
+
+static void frameReplayCapture(const unsigned char *frameData)
+{
+	CAPTURE_CONFIGURATION configuration = replayInterop->captureConfiguration;
+	const unsigned int decimation = configuration.decimation;
+	const unsigned int sensorColumns = replayInterop->captureSensor.columns;
+	const unsigned int sensorRows = replayInterop->captureSensor.rows;
+
+	if(configuration.format != CAPTURE_FORMAT_UYVY && configuration.format != CAPTURE_FORMAT_Y8) configuration.format = CAPTURE_FORMAT_RGB;
+	configuration.orientation &= CAPTURE_ORIENTATION_NORMAL;
+
+	if((decimation != 1 && decimation != 2 && decimation != 4) ||
+		configuration.columns == 0 ||
+		configuration.rows == 0 ||
+		(configuration.firstColumn % CAPTURE_COLUMN_ALIGNMENT) != 0 ||
+		(configuration.columns % (CAPTURE_COLUMN_ALIGNMENT * decimation)) != 0 ||
+		(configuration.rows % decimation) != 0 ||
+		configuration.firstColumn + configuration.columns > sensorColumns ||
+		configuration.firstRow + configuration.rows > sensorRows)
+	{
+		configuration.firstColumn = 0;
+		configuration.firstRow = 0;
+		configuration.columns = sensorColumns;
+		configuration.rows = sensorRows;
+		configuration.decimation = 1;
+	}
+
+	if(configuration.format == CAPTURE_FORMAT_RGB &&
+		configuration.decimation == 1 &&
+		configuration.columns == sensorColumns &&
+		configuration.rows == sensorRows &&
+		configuration.orientation == (replayHeader->orientation & CAPTURE_ORIENTATION_NORMAL))
+	{
+		memcpy((void *)replayInterop->imageData, frameData, replayHeader->frameBytes);
+	}
+	else
+	{
+		const unsigned int outputColumns = configuration.columns / configuration.decimation;
+		const unsigned int outputRows = configuration.rows / configuration.decimation;
+		const bool columnsForward = CAPTURE_COLUMNS_FORWARD(configuration.orientation);
+		const bool rowsForward = CAPTURE_ROWS_FORWARD(configuration.orientation);
+		const bool recordedColumnsForward = CAPTURE_COLUMNS_FORWARD(replayHeader->orientation);
+		const bool recordedRowsForward = CAPTURE_ROWS_FORWARD(replayHeader->orientation);
+		/* from a pixel to the one decimation columns before it in sensor order */
+		const int previousPixel = (recordedColumnsForward ? -1 : 1) * (int)(configuration.decimation * BYTES_PER_PIXEL_RGB);
+		unsigned char *output = (unsigned char *)replayInterop->imageData;
+
+		for(unsigned int y = 0; y < outputRows; y++)
+		{
+			unsigned int sensorRow = configuration.firstRow + (rowsForward ? y : outputRows - 1 - y) * configuration.decimation;
+			unsigned int recordedRow = recordedRowsForward ? sensorRow : sensorRows - 1 - sensorRow;
+			const unsigned char *frameLine = frameData + recordedRow * sensorColumns * BYTES_PER_PIXEL_RGB;
+			for(unsigned int x = 0; x < outputColumns; x++)
+			{
+				unsigned int sensorColumn = configuration.firstColumn + (columnsForward ? x : outputColumns - 1 - x) * configuration.decimation;
+				unsigned int recordedColumn = recordedColumnsForward ? sensorColumn : sensorColumns - 1 - sensorColumn;
+				const unsigned char *pixel = frameLine + recordedColumn * BYTES_PER_PIXEL_RGB;
+				if(configuration.format == CAPTURE_FORMAT_RGB)
+				{
+					memcpy(output, pixel, BYTES_PER_PIXEL_RGB);
+					output += BYTES_PER_PIXEL_RGB;
+				}
+				else if(configuration.format == CAPTURE_FORMAT_Y8)
+				{
+					*(output++) = frameReplayLuma(pixel);
+				}
+				else
+				{
+					/*
+					 * Stored forwards a pair is U Y V Y, backwards Y V Y U; either way the
+					 * pixel first in sensor order carries U and its partner V, both
+					 * sampled at the first.
+					 */
+					bool sensorFirst = columnsForward ? !(x & 1) : (x & 1);
+					unsigned char chroma = sensorFirst ? frameReplayChroma(pixel, 0) : frameReplayChroma(pixel + previousPixel, 2);
+					if(columnsForward) *(output++) = chroma;
+					*(output++) = frameReplayLuma(pixel);
+					if(!columnsForward) *(output++) = chroma;
+				}
+			}
+		}
+	}
+	replayInterop->frameConfiguration = configuration;
+	replayInterop->captureStatistics.frames++;
+	frameReplaySegment(configuration);
+}
+
+static void frameReplayRun(int originalSpeed)
+{
+	volatile uint32_t *imageReadyFlag = &(replayInterop->imageReadyFlag);
+	const uint64_t frames = frameReplayFrameCount();
+	uint64_t firstTimestamp = 0;
+	uint64_t start = frameRecordingNow();
+
+	for(uint64_t frame = 0; frame < frames; frame++)
+	{
+		const unsigned char *slot = frameReplaySlot(frame);
+		const FRAME_RECORDING_SLOT *slotHeader = (const FRAME_RECORDING_SLOT *)slot;
+
+		while(*imageReadyFlag == IMAGE_READY)
+		{
+			if(replayStopping) return;
+			usleep(100);
+		}
+
+		if(frame == 0) firstTimestamp = slotHeader->timestamp;
+		if(originalSpeed)
+		{
+			uint64_t due = start + (slotHeader->timestamp - firstTimestamp);
+			uint64_t now = frameRecordingNow();
+			if(due > now) usleep((due - now) / 1000);
+		}
+
+		frameReplayCapture(slot + FRAME_RECORDING_SLOT_HEADER_SIZE);
+		__sync_synchronize();
+		*imageReadyFlag = IMAGE_READY;
+	}
+
+	while(*imageReadyFlag == IMAGE_READY && !replayStopping) usleep(100);
+	replayDone = true;
+}
+
+static bool frameReplaySensorSupported(uint32_t width, uint32_t height)
+{
+	return (width == IMAGE_COLUMNS_IN_PIXELS_QVGA && height == IMAGE_ROWS_IN_PIXELS_QVGA) ||
+			(width == IMAGE_COLUMNS_IN_PIXELS_VGA && height == IMAGE_ROWS_IN_PIXELS_VGA);
+}
+
+static void frameReplayCreateInterop(uint32_t width, uint32_t height)
+{
+	replayInterop = (PRU_INTEROP_1_DATA *)calloc(1, sizeof(PRU_INTEROP_1_DATA));
+	replayInterop->imageReadyFlag = IMAGE_NOT_READY;
+	replayInterop->captureSensor.columns = width;
+	replayInterop->captureSensor.rows = height;
+	setPRUInterop1Data(replayInterop);
+}
+
+int frameReplayStart(const char *filename, int originalSpeed)
+{
+	struct stat fileStatus;
+
+	int file = open(filename, O_RDONLY);
+	if(file < 0 || fstat(file, &fileStatus) != 0 || (size_t)fileStatus.st_size < FRAME_RECORDING_PAGE_SIZE)
+	{
+		fprintf(stderr, "Could not open recording %s\n", filename);
+		if(file >= 0) close(file);
+		return -1;
+	}
+
+	replayMapBytes = fileStatus.st_size;
+	replayMap = (unsigned char *)mmap(NULL, replayMapBytes, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if(replayMap == MAP_FAILED)
+	{
+		replayMap = NULL;
+		return -1;
+	}
+
+	replayHeader = (const FRAME_RECORDING_HEADER *)replayMap;
+	if(replayHeader->magic != FRAME_RECORDING_MAGIC ||
+		replayHeader->version != FRAME_RECORDING_VERSION ||
+		!frameReplaySensorSupported(replayHeader->width, replayHeader->height) ||
+		replayHeader->frameBytes != replayHeader->width * replayHeader->height * BYTES_PER_PIXEL_RGB)
+	{
+		fprintf(stderr, "%s is not a recording of whole QVGA or VGA BGR frames\n", filename);
+		frameReplayStop();
+		return -1;
+	}
+	madvise(replayMap, replayMapBytes, MADV_SEQUENTIAL);
+
+	frameReplayCreateInterop(replayHeader->width, replayHeader->height);
+
+	replayStopping = false;
+	replayDone = false;
+	replayThread = thread(frameReplayRun, originalSpeed);
+
+	printf("Replaying %llu frames from %s\n", (unsigned long long)frameReplayFrameCount(), filename);
+	return 0;
+}
+
+/*
+ * The test pattern's frame number frame, as PRU1 draws it: bars by
+ * TEST_PATTERN_BAR_CHANNEL a TEST_PATTERN_BARS'th of the width each, moved along by
+ * the frame count, and the square over them.
+ */
+static void frameTestPatternDraw(unsigned char *frameData, uint32_t columns, uint32_t rows, uint32_t frame)
+{
+	const uint32_t barWidth = columns / TEST_PATTERN_BARS;
+	const uint32_t shift = (frame * TEST_PATTERN_BAR_STEP) % columns;
+	const uint32_t blobColumn = TEST_PATTERN_BOUNCE(frame * TEST_PATTERN_BLOB_STEP_COLUMNS, columns - barWidth);
+	const uint32_t blobRow = TEST_PATTERN_BOUNCE(frame * TEST_PATTERN_BLOB_STEP_ROWS, rows - barWidth);
+	unsigned char *pixel = frameData;
+
+	for(uint32_t row = 0; row < rows; row++)
+	{
+		const bool inBlobRow = row - blobRow < barWidth;
+		for(uint32_t column = 0; column < columns; column++)
+		{
+			if(inBlobRow && column - blobColumn < barWidth)
+			{
+				pixel[0] = TEST_PATTERN_BLOB_BLUE;
+				pixel[1] = TEST_PATTERN_BLOB_GREEN;
+				pixel[2] = TEST_PATTERN_BLOB_RED;
+			}
+			else
+			{
+				const uint32_t bar = ((column + shift) % columns) / barWidth;
+				for(int channel = 0; channel < 3; channel++) pixel[channel] = TEST_PATTERN_BAR_CHANNEL(bar, channel);
+			}
+			pixel += BYTES_PER_PIXEL_RGB;
+		}
+	}
+}
+
+/*
+ * Paced like PRU1's test pattern: a frame is started no sooner than a period (or the
+ * capture governor's interval, if longer) after the last one was, and not before the
+ * host has taken the last one.
+ */
+static void frameTestPatternRun(int framesPerSecond)
+{
+	volatile uint32_t *imageReadyFlag = &(replayInterop->imageReadyFlag);
+	const uint64_t period = (framesPerSecond > 0) ? 1000000000ull / framesPerSecond : 0;
+	vector<unsigned char> frameData(testPatternHeader.frameBytes);
+	uint64_t due = 0;
+
+	while(!replayStopping)
+	{
+		while(*imageReadyFlag == IMAGE_READY)
+		{
+			if(replayStopping) return;
+			usleep(100);
+		}
+
+		const uint64_t governed = replayInterop->captureGovernor.frameIntervalMicroseconds * 1000ull;
+		uint64_t now = frameRecordingNow();
+		if(due > now) usleep((due - now) / 1000);
+		due = max(due, now) + max(period, governed);
+
+		frameTestPatternDraw(frameData.data(), testPatternHeader.width, testPatternHeader.height, replayInterop->captureStatistics.frames);
+		frameReplayCapture(frameData.data());
+		__sync_synchronize();
+		*imageReadyFlag = IMAGE_READY;
+	}
+}
+
+int frameReplayStartTestPattern(int width, int height, int framesPerSecond)
+{
+	if(!frameReplaySensorSupported(width, height))
+	{
+		fprintf(stderr, "The test pattern can only stand in for a QVGA or VGA sensor, not %dx%d\n", width, height);
+		return -1;
+	}
+
+	memset(&testPatternHeader, 0, sizeof(testPatternHeader));
+	testPatternHeader.magic = FRAME_RECORDING_MAGIC;
+	testPatternHeader.version = FRAME_RECORDING_VERSION;
+	testPatternHeader.width = width;
+	testPatternHeader.height = height;
+	testPatternHeader.frameBytes = width * height * BYTES_PER_PIXEL_RGB;
+	testPatternHeader.orientation = CAPTURE_ORIENTATION_NORMAL;
+	replayHeader = &testPatternHeader;
+	frameReplayCreateInterop(width, height);
+
+	replayStopping = false;
+	replayDone = false;
+	replayThread = thread(frameTestPatternRun, framesPerSecond);
+
+	if(framesPerSecond > 0) printf("Drawing a %dx%d test pattern at up to %d frames per second\n", width, height, framesPerSecond);
+	else printf("Drawing a %dx%d test pattern as fast as frames are taken\n", width, height);
+	return 0;
+}
+
+int frameReplayFinished(void)
+{
+	return replayDone;
+}
+
+void frameReplayStop(void)
+{
+	replayStopping = true;
+	if(replayThread.joinable()) replayThread.join();
+
+	if(replayMap != NULL) munmap(replayMap, replayMapBytes);
+	replayMap = NULL;
+	replayHeader = NULL;
+}
@@ -0,0 +1,160 @@
+/** @file frameRecording.hpp
+ *  @brief Function prototypes for recording frames to a file and replaying them.
+ *
+ *  These are the prototypes for functions that: stream the raw frames PRU1 delivers,
+ *  with the time each one arrived, to a recording file from a background thread, and
+ *  replay such a file into a stand-in for the PRU1 shared memory so that the rest of
+ *  the vision code runs exactly as it does on the robot, on any Linux machine.
+ *
+ *  A recording is a FRAME_RECORDING_HEADER page, followed by one page aligned slot per
+ *  frame (a FRAME_RECORDING_SLOT header then the raw frame bytes), followed by an index
+ *  of slot offsets and timestamps written when the recording is closed. Because every
+ *  slot is page aligned the file can be mapped and its frames used in place.
+ *
+ *  The same stand-in can be fed PRU1's test pattern instead, drawn on the host, so the
+ *  whole pipeline can be run and its throughput measured with no PRU or camera.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef FRAMERECORDING_HPP_
+#define FRAMERECORDING_HPP_
+
+#include <stdint.h>
+
+#define FRAME_RECORDING_MAGIC				0x52464242	/* "BBFR" */
+#define FRAME_RECORDING_VERSION				1
+#define FRAME_RECORDING_PAGE_SIZE			4096
+#define FRAME_RECORDING_SLOT_HEADER_SIZE	64
+#define FRAME_RECORDING_QUEUE_LENGTH		8
+#define FRAME_TEST_PATTERN_DEFAULT_RATE		30
+
+typedef struct{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t type;
+	uint32_t frameBytes;
+	uint64_t slotBytes;
+	uint64_t frameCount;
+	uint64_t indexOffset;
+	uint32_t orientation;
+	uint32_t reserved;
+} FRAME_RECORDING_HEADER;
+
+typedef struct{
+	uint64_t sequence;
+	uint64_t timestamp;
+} FRAME_RECORDING_SLOT;
+
+typedef struct{
+	uint64_t offset;
+	uint64_t timestamp;
+} FRAME_RECORDING_INDEX;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Gets the monotonic time frames are stamped with
+ *
+ * 	@return nanoseconds on CLOCK_MONOTONIC.
+ *
+ */
+uint64_t frameRecordingNow(void);
+
+/** @brief Opens a recording file and starts its writer thread
+ *
+ *	@param	filename the file to record to. It is truncated if it exists.
+ *	@param	width the frame width in pixels.
+ *	@param	height the frame height in pixels.
+ *	@param	type the OpenCV type of the frame (CV_8UC3 for the GRB422 capture).
+ *	@param	frameBytes the size of one frame in bytes.
+ *	@param	orientation the CAPTURE_ORIENTATION_ the frames were stored in. Recordings
+ *			from before this was kept read back as 0, CAPTURE_ORIENTATION_ROTATED,
+ *			which is what they were.
+ * 	@return 0 on success, -1 if the file couldn't be created.
+ *
+ */
+int frameRecorderStart(const char *filename, int width, int height, int type, uint32_t frameBytes, uint32_t orientation);
+
+/** @brief Queues a frame for the writer thread
+ *
+ *	This only copies the frame into a preallocated queue slot, so it is cheap enough
+ *	to call on every frame. If the writer has fallen so far behind that the queue is
+ *	full the frame is dropped and counted rather than stalling the caller.
+ *
+ *	@param	frame the raw frame bytes.
+ *	@param	timestamp when the frame arrived, from frameRecordingNow.
+ * 	@return void.
+ *
+ */
+void frameRecorderWrite(const void *frame, uint64_t timestamp);
+
+/** @brief Flushes the queue, writes the index and closes the recording
+ *
+ * 	@return void.
+ *
+ */
+void frameRecorderStop(void);
+
+/** @brief Starts replaying a recording in place of PRU1
+ *
+ *	Maps the recording, allocates a stand-in for the PRU1 shared memory and hands it
+ *	to the PRU module so getPRUInterop1Data returns it, then starts a thread that
+ *	follows the same handshake PRU1 does: wait for the image ready flag to be cleared,
+ *	copy the next frame in, set the flag. At original speed frames are released at
+ *	their recorded intervals; at maximum speed as soon as the flag is cleared. The
+ *	recording has to be of whole BGR frames; the capture window, decimation and format
+ *	the host configures are applied to them as each is copied in. The recording's
+ *	frame size stands in for the sensor resolution PRU1 would report.
+ *
+ *	@param	filename the recording to replay.
+ *	@param	originalSpeed non-zero to keep the recorded frame timing.
+ * 	@return 0 on success, -1 if the file isn't of whole QVGA or VGA BGR frames.
+ *
+ */
+int frameReplayStart(const char *filename, int originalSpeed);
+
+/** @brief Starts drawing the test pattern in place of PRU1
+ *
+ *	Sets up the same stand-in for the PRU1 shared memory as frameReplayStart, but its
+ *	thread draws the pattern PRU1's test pattern mode does (see
+ *	TEST_PATTERN_CONFIGURATION) a whole sensor frame at a time and hands each over as
+ *	a replayed frame, so the capture window, decimation, format, orientation and
+ *	segmentation are applied to it the same way. It never finishes; stop it with
+ *	frameReplayStop.
+ *
+ *	@param	width the sensor width to stand in for, QVGA or VGA.
+ *	@param	height the sensor height to stand in for.
+ *	@param	framesPerSecond the most frames to hand over a second, 0 for as fast as
+ *			they are taken.
+ * 	@return 0 on success, -1 if the size isn't QVGA or VGA.
+ *
+ */
+int frameReplayStartTestPattern(int width, int height, int framesPerSecond);
+
+/** @brief Checks whether every recorded frame has been handed over and consumed
+ *
+ * 	@return non-zero once the replay is finished.
+ *
+ */
+int frameReplayFinished(void);
+
+/** @brief Stops the replay (or test pattern) thread and unmaps the recording
+ *
+ * 	@return void.
+ *
+ */
+void frameReplayStop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAMERECORDING_HPP_ */
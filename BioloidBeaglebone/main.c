@@ -15,60 +15,307 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 
 #include "cv.h"
 #include "highgui.h"
 #include "pru.h"
 #include "PRUInterop.h"
 #include "motionManager.h"
+#include "motionLookAt.h"
 #include "visionManager.hpp"
+#include "frameRecording.hpp"
+#include "commandInput.h"
+
+#define VISION_CONFIG_DEFAULT_FILE		"visionConfig.txt"
+
+/*
+ * Headless, the loop waits for a frame at most this long before checking for commands
+ * again, so commands still get through when no frames are arriving.
+ */
+#define HEADLESS_FRAME_TIMEOUT_MS		50
+
+static const struct option longOptions[] =
+{
+	{"vision-config",	required_argument,	NULL,	'v'},
+	{"autotune",		optional_argument,	NULL,	'a'},
+	{"background-load",	no_argument,		NULL,	'b'},
+	{"model-memory-budget",	required_argument,	NULL,	'm'},
+	{"record",			required_argument,	NULL,	'r'},
+	{"replay",			required_argument,	NULL,	'p'},
+	{"replay-max-speed",	no_argument,		NULL,	's'},
+	{"headless",		no_argument,		NULL,	'h'},
+	{"control-socket",	required_argument,	NULL,	'c'},
+	{"dump-prefix",		required_argument,	NULL,	'd'},
+	{"publish",			optional_argument,	NULL,	'P'},
+	{"motion-gate",		optional_argument,	NULL,	'g'},
+	{"motion-max-skip",	required_argument,	NULL,	'G'},
+	{"focus",			no_argument,		NULL,	'f'},
+	{"latency-ms",		required_argument,	NULL,	'l'},
+	{"look-at",			required_argument,	NULL,	'L'},
+	{"frame-budget-ms",	required_argument,	NULL,	'B'},
+	{"capture-window",	required_argument,	NULL,	'w'},
+	{"capture-decimation",	required_argument,	NULL,	'D'},
+	{"capture-format",	required_argument,	NULL,	'F'},
+	{"pru-segmentation",	no_argument,		NULL,	'S'},
+	{"capture-orientation",	required_argument,	NULL,	'O'},
+	{"test-pattern",	optional_argument,	NULL,	'T'},
+	{"host-test-pattern",	optional_argument,	NULL,	'H'},
+	{"capture-every",	required_argument,	NULL,	'E'},
+	{"capture-interval-ms",	required_argument,	NULL,	'I'},
+	{"capture-governor",	no_argument,		NULL,	'A'},
+	{NULL,				0,					NULL,	0}
+};
 
 int main (int argc, char *argv[])
 {
+	const char *visionConfigFile = VISION_CONFIG_DEFAULT_FILE;
+	const char *autotuneFrames = NULL;
+	int autotune = 0;
+	int backgroundLoad = 0;
+	long modelMemoryBudget = 0;
+	const char *recordFile = NULL;
+	const char *replayFile = NULL;
+	int replayOriginalSpeed = 1;
+	int headless = 0;
+	const char *controlSocket = NULL;
+	const char *dumpPrefix = NULL;
+	int publish = 0;
+	const char *publishName = NULL;
+	int motionGateThreshold = 0;
+	int motionGateMaxSkip = 0;
+	int focus = 0;
+	int latency = -1;
+	const char *lookAtCalibration = NULL;
+	int frameBudget = 0;
+	int captureX = 0, captureY = 0, captureWidth = 0, captureHeight = 0;
+	int captureDecimation = 1;
+	int captureFormat = CAPTURE_FORMAT_RGB;
+	int PRUSegmentation = 0;
+	int captureOrientation = CAPTURE_ORIENTATION_ROTATED;
+	int testPattern = 0;
+	int testPatternRate = FRAME_TEST_PATTERN_DEFAULT_RATE;
+	int hostTestPattern = 0;
+	int hostTestPatternVGA = 0;
+	int captureEvery = 1;
+	int captureInterval = 0;
+	int captureGoverned = 0;
+	int option;
+
+	while((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1)
+	{
+		switch(option)
+		{
+			case 'v':
+				visionConfigFile = optarg;
+				break;
+			case 'a':
+				autotune = 1;
+				autotuneFrames = optarg;
+				break;
+			case 'b':
+				backgroundLoad = 1;
+				break;
+			case 'm':
+				modelMemoryBudget = atol(optarg);
+				break;
+			case 'r':
+				recordFile = optarg;
+				break;
+			case 'p':
+				replayFile = optarg;
+				break;
+			case 's':
+				replayOriginalSpeed = 0;
+				break;
+			case 'h':
+				headless = 1;
+				break;
+			case 'c':
+				controlSocket = optarg;
+				break;
+			case 'd':
+				dumpPrefix = optarg;
+				break;
+			case 'P':
+				publish = 1;
+				publishName = optarg;
+				break;
+			case 'g':
+				motionGateThreshold = (optarg != NULL) ? atoi(optarg) : -1;
+				break;
+			case 'G':
+				motionGateMaxSkip = atoi(optarg);
+				break;
+			case 'f':
+				focus = 1;
+				break;
+			case 'l':
+				latency = atoi(optarg);
+				break;
+			case 'L':
+				lookAtCalibration = optarg;
+				break;
+			case 'B':
+				frameBudget = atoi(optarg);
+				break;
+			case 'w':
+				if(sscanf(optarg, "%d,%d,%d,%d", &captureX, &captureY, &captureWidth, &captureHeight) != 4) return -1;
+				break;
+			case 'D':
+				captureDecimation = atoi(optarg);
+				break;
+			case 'F':
+				if(strcmp(optarg, "rgb") == 0) captureFormat = CAPTURE_FORMAT_RGB;
+				else if(strcmp(optarg, "uyvy") == 0) captureFormat = CAPTURE_FORMAT_UYVY;
+				else if(strcmp(optarg, "y8") == 0) captureFormat = CAPTURE_FORMAT_Y8;
+				else return -1;
+				break;
+			case 'S':
+				PRUSegmentation = 1;
+				break;
+			case 'O':
+				if(strcmp(optarg, "rotated") == 0) captureOrientation = CAPTURE_ORIENTATION_ROTATED;
+				else if(strcmp(optarg, "flipped") == 0) captureOrientation = CAPTURE_ORIENTATION_FLIPPED;
+				else if(strcmp(optarg, "mirrored") == 0) captureOrientation = CAPTURE_ORIENTATION_MIRRORED;
+				else if(strcmp(optarg, "normal") == 0) captureOrientation = CAPTURE_ORIENTATION_NORMAL;
+				else return -1;
+				break;
+			case 'T':
+				testPattern = 1;
+				if(optarg != NULL) testPatternRate = atoi(optarg);
+				break;
+			case 'H':
+				hostTestPattern = 1;
+				if(optarg != NULL && strcmp(optarg, "vga") == 0) hostTestPatternVGA = 1;
+				else if(optarg != NULL && strcmp(optarg, "qvga") != 0) return -1;
+				break;
+			case 'E':
+				captureEvery = atoi(optarg);
+				break;
+			case 'I':
+				captureInterval = atoi(optarg);
+				break;
+			case 'A':
+				captureGoverned = 1;
+				break;
+			default:
+				return -1;
+		}
+	}
 
-	if(argc < 13)
+	if(argc - optind < 12)
 	{
-		fprintf(stderr, "Usage: BioloidBeaglebone PRU0Firmware PRU1Firmware MotionFile MLCaffeNamesFile MLProtoFile MLCaffeFile MLCaffeConfidence MLDarknetNamesFile MLDarknetCfgFile MLDarknetWeightsFile MLDarknetConfidence MLDarknetNMSThreshold");
+		fprintf(stderr, "Usage: BioloidBeaglebone [--vision-config File] [--autotune[=FramesDirectory]] [--background-load] [--model-memory-budget MB] [--record File] [--replay File [--replay-max-speed]] [--headless [--control-socket Path] [--dump-prefix Prefix]] [--publish[=SharedMemoryName]] [--motion-gate[=LumaLevels] [--motion-max-skip Frames]] [--focus] [--latency-ms Milliseconds] [--look-at CalibrationFile] [--frame-budget-ms Milliseconds] [--capture-window X,Y,Width,Height] [--capture-decimation 1|2|4] [--capture-format rgb|uyvy|y8] [--pru-segmentation] [--capture-orientation rotated|flipped|mirrored|normal] [--test-pattern[=FramesPerSecond]] [--host-test-pattern[=qvga|vga]] [--capture-every Frames] [--capture-interval-ms Milliseconds] [--capture-governor] PRU0Firmware PRU1Firmware MotionFile MLCaffeNamesFile MLProtoFile MLCaffeFile MLCaffeConfidence MLDarknetNamesFile MLDarknetCfgFile MLDarknetWeightsFile MLDarknetConfidence MLDarknetNMSThreshold");
 		return -1;
 	}
 
 	int key = 0;
+	char **arguments = argv + optind - 1;
+
+	const char *PRU_0Firmware = arguments[1];
+	const char *PRU_1Firmware = arguments[2];
+	const char *motionFile = arguments[3];
+	const char *caffeNamesFile = arguments[4];
+	const char *protoFile = arguments[5];
+	const char *modelFile = arguments[6];
+	float caffeConfidence = atof(arguments[7]);
+	const char *darknetNamesFile = arguments[8];
+	const char *cfgFile = arguments[9];
+	const char *weightsFile = arguments[10];
+	float darknetConfidence = atof(arguments[11]);
+	float darknetNMSThreshold = atof(arguments[12]);
+
+	if(replayFile != NULL)
+	{
+		if(frameReplayStart(replayFile, replayOriginalSpeed) != 0) return -1;
+	}
+	else if(hostTestPattern)
+	{
+		if(frameReplayStartTestPattern(hostTestPatternVGA ? IMAGE_COLUMNS_IN_PIXELS_VGA : IMAGE_COLUMNS_IN_PIXELS_QVGA,
+										hostTestPatternVGA ? IMAGE_ROWS_IN_PIXELS_VGA : IMAGE_ROWS_IN_PIXELS_QVGA,
+										testPatternRate) != 0) return -1;
+	}
+	else
+	{
+		initializePRU(PRU_0Firmware, PRU_1Firmware);
+		motionManagerInitialize(motionFile);
+	}
+
+	if(headless && commandInputInitialize(controlSocket) != 0) return -1;
+
+	if(recordFile != NULL) visionManagerSetRecording(recordFile);
+	visionManagerSetHeadless(headless, dumpPrefix);
+	if(publish) visionManagerSetPublishing(publishName);
+	visionManagerSetMotionGate(motionGateThreshold, motionGateMaxSkip);
+	visionManagerSetFocus(focus);
+	if(latency >= 0) visionManagerSetPredictionLatency(latency);
+	if(frameBudget > 0) visionManagerSetFrameBudget(frameBudget);
+	visionManagerSetCaptureWindow(captureX, captureY, captureWidth, captureHeight, captureDecimation);
+	visionManagerSetCaptureFormat(captureFormat);
+	visionManagerSetPRUSegmentation(PRUSegmentation);
+	visionManagerSetCaptureOrientation(captureOrientation);
+	visionManagerSetTestPattern(testPattern && !hostTestPattern, testPatternRate);
+	visionManagerSetCaptureGovernor(captureEvery, captureInterval, captureGoverned);
+	visionManagerConfigure(visionConfigFile);
+	visionManagerSetModelLoading(backgroundLoad, modelMemoryBudget);
+	if(visionManagerInitialize(caffeNamesFile,
+								protoFile,
+								modelFile,
+								caffeConfidence,
+								darknetNamesFile,
+								cfgFile,
+								weightsFile,
+								darknetConfidence,
+								darknetNMSThreshold) != 0) return -1;
+
+	if(replayFile == NULL && !hostTestPattern && lookAtCalibration != NULL)
+	{
+		int sensorWidth, sensorHeight;
+		visionManagerGetSensorSize(&sensorWidth, &sensorHeight);
+		if(motionLookAtInitialize(lookAtCalibration, sensorWidth, sensorHeight) != 0) return -1;
+	}
 
-	const char *PRU_0Firmware = argv[1];
-	const char *PRU_1Firmware = argv[2];
-	const char *motionFile = argv[3];
-	const char *caffeNamesFile = argv[4];
-	const char *protoFile = argv[5];
-	const char *modelFile = argv[6];
-	float caffeConfidence = atof(argv[7]);
-	const char *darknetNamesFile = argv[8];
-	const char *cfgFile = argv[9];
-	const char *weightsFile = argv[10];
-	float darknetConfidence = atof(argv[11]);
-	float darknetNMSThreshold = atof(argv[12]);
-
-	initializePRU(PRU_0Firmware, PRU_1Firmware);
-
-	motionManagerInitialize(motionFile);
-	visionManagerInitialize(caffeNamesFile,
-							protoFile,
-							modelFile,
-							caffeConfidence,
-							darknetNamesFile,
-							cfgFile,
-							weightsFile,
-							darknetConfidence,
-							darknetNMSThreshold);
-
-	while(key != 'x')
+	if(autotune)
+	{
+		key = 'x';
+		visionManagerAutotune(autotuneFrames, visionConfigFile);
+	}
+
+	while(key != 'x' && !(replayFile != NULL && frameReplayFinished()))
 	{
 		visionManagerProcess(key);
 		motionManagerProcess(key);
-		key = cvWaitKey(25);
+		if(lookAtCalibration != NULL)
+		{
+			float targetX, targetY;
+			uint64_t measured = 0;
+			int found = visionManagerMeasuredTarget(&targetX, &targetY, &measured);
+			motionLookAtUpdate(found, targetX, targetY, measured);
+			visionManagerSetControlDemand(found);
+		}
+		if(headless)
+		{
+			visionManagerWaitForFrame(HEADLESS_FRAME_TIMEOUT_MS);
+			key = commandInputRead();
+		}
+		else
+		{
+			key = cvWaitKey(25);
+		}
 	}
 
+	if(headless) commandInputUninitialize();
 	visionManagerUninitialize();
-	stopPRU_0();
-	stopPRU_1();
+	if(replayFile != NULL || hostTestPattern)
+	{
+		frameReplayStop();
+	}
+	else
+	{
+		stopPRU_0();
+		stopPRU_1();
+	}
 }
@@ -0,0 +1,222 @@
+/** @file motionLookAt.c
+ *  @brief Functions for pointing the head at the tracked target.
+ *
+ *  The controller is proportional with a rate limit: each new measurement aims the
+ *  goal at the goal in force when its frame was captured plus gain times the
+ *  calibrated correction, then clamps the change to rate times the time since the
+ *  last update (itself capped, so a stall doesn't save up a big jump) and the goal to
+ *  the axis' limits. The goals sent are kept for the last LOOK_AT_HISTORY_LENGTH
+ *  updates so the goal at capture can be looked up. The target position handed in is
+ *  the one measured in that frame, not the tracker's prediction: the prediction is for
+ *  a later time, and its velocity is in the image so it has the head's own motion in
+ *  it, so it doesn't go with the goal at capture. Nothing here predicts the target
+ *  past the latency; that would have to be done on the joint goals, or with the head
+ *  motion taken out of the image positions before they reach the tracker.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "motionLookAt.h"
+#include "motionManager.h"
+
+static LOOK_AT_AXIS lookAtAxes[2];
+static const char *lookAtAxisNames[2] = {"pan.", "tilt."};
+static float lookAtFrameCenter[2];
+static float lookAtGain = LOOK_AT_DEFAULT_GAIN;
+static float lookAtDeadband = LOOK_AT_DEFAULT_DEADBAND;
+static int lookAtEnabled = 0;
+static uint16_t lookAtSentGoals[2];
+static uint64_t lookAtLastUpdate;
+static uint64_t lookAtLastMeasured;
+static uint64_t lookAtHistoryTimes[LOOK_AT_HISTORY_LENGTH];
+static float lookAtHistoryGoals[LOOK_AT_HISTORY_LENGTH][2];
+static int lookAtHistoryCount;
+static int lookAtHistoryNext;
+
+static uint64_t motionLookAtNow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void motionLookAtRecord(uint64_t time)
+{
+	lookAtHistoryTimes[lookAtHistoryNext] = time;
+	lookAtHistoryGoals[lookAtHistoryNext][0] = lookAtAxes[0].goal;
+	lookAtHistoryGoals[lookAtHistoryNext][1] = lookAtAxes[1].goal;
+	lookAtHistoryNext = (lookAtHistoryNext + 1) % LOOK_AT_HISTORY_LENGTH;
+	if(lookAtHistoryCount < LOOK_AT_HISTORY_LENGTH) lookAtHistoryCount++;
+}
+
+/*
+ * The goal that was in force at the given time: the newest one set at or before it,
+ * or the oldest kept if the time is older than the history.
+ */
+static float motionLookAtGoalAt(int axis, uint64_t time)
+{
+	int entry = lookAtHistoryNext;
+	for(int i = 0; i < lookAtHistoryCount; i++)
+	{
+		entry = (lookAtHistoryNext - 1 - i + LOOK_AT_HISTORY_LENGTH) % LOOK_AT_HISTORY_LENGTH;
+		if(lookAtHistoryTimes[entry] <= time) break;
+	}
+	return lookAtHistoryGoals[entry][axis];
+}
+
+static void motionLookAtParseAxis(LOOK_AT_AXIS *axis, const char *key, const char *value)
+{
+	float pixels, units;
+
+	if(strcmp(key, "id") == 0) axis->ID = atoi(value);
+	else if(strcmp(key, "min") == 0) axis->minimum = atoi(value);
+	else if(strcmp(key, "max") == 0) axis->maximum = atoi(value);
+	else if(strcmp(key, "center") == 0) axis->center = atoi(value);
+	else if(strcmp(key, "rate") == 0) axis->rate = atof(value);
+	else if(strcmp(key, "speed") == 0) axis->speed = atoi(value);
+	else if(strcmp(key, "point") == 0 && axis->pointCount < LOOK_AT_MAX_POINTS && sscanf(value, "%f,%f", &pixels, &units) == 2)
+	{
+		/* keep the points sorted by pixels, so lookups can walk them in order */
+		int i = axis->pointCount++;
+		for(; i > 0 && axis->pixels[i - 1] > pixels; i--)
+		{
+			axis->pixels[i] = axis->pixels[i - 1];
+			axis->units[i] = axis->units[i - 1];
+		}
+		axis->pixels[i] = pixels;
+		axis->units[i] = units;
+	}
+}
+
+/*
+ * Interpolates the calibration between the points either side, holding the end
+ * points' corrections beyond them.
+ */
+static float motionLookAtCorrection(const LOOK_AT_AXIS *axis, float pixels)
+{
+	if(pixels <= axis->pixels[0]) return axis->units[0];
+	for(int i = 1; i < axis->pointCount; i++)
+	{
+		if(pixels <= axis->pixels[i])
+		{
+			float fraction = (pixels - axis->pixels[i - 1]) / (axis->pixels[i] - axis->pixels[i - 1]);
+			return axis->units[i - 1] + fraction * (axis->units[i] - axis->units[i - 1]);
+		}
+	}
+	return axis->units[axis->pointCount - 1];
+}
+
+static void motionLookAtSend(int force)
+{
+	uint8_t IDs[2];
+	uint16_t goals[2];
+	uint16_t speeds[2];
+
+	for(int i = 0; i < 2; i++)
+	{
+		IDs[i] = lookAtAxes[i].ID;
+		goals[i] = (uint16_t)lroundf(lookAtAxes[i].goal);
+		speeds[i] = lookAtAxes[i].speed;
+	}
+	if(!force && goals[0] == lookAtSentGoals[0] && goals[1] == lookAtSentGoals[1]) return;
+
+	motionManagerSetJointGoals(IDs, goals, speeds, 2);
+	lookAtSentGoals[0] = goals[0];
+	lookAtSentGoals[1] = goals[1];
+}
+
+int motionLookAtInitialize(const char *calibrationFile, int frameWidth, int frameHeight)
+{
+	char line[128];
+
+	FILE *file = fopen(calibrationFile, "r");
+	if(!file)
+	{
+		fprintf(stderr, "Could not open look-at calibration %s\n", calibrationFile);
+		return -1;
+	}
+
+	for(int i = 0; i < 2; i++)
+	{
+		memset(&lookAtAxes[i], 0, sizeof(LOOK_AT_AXIS));
+		lookAtAxes[i].ID = -1;
+		lookAtAxes[i].maximum = 1023;
+		lookAtAxes[i].center = 512;
+		lookAtAxes[i].rate = LOOK_AT_DEFAULT_RATE;
+	}
+
+	while(fgets(line, sizeof(line), file))
+	{
+		char *equals = strchr(line, '=');
+		if(equals == NULL) continue;
+		*equals = '\0';
+		line[strcspn(line, " \t")] = '\0';
+
+		if(strcmp(line, "gain") == 0) lookAtGain = atof(equals + 1);
+		else if(strcmp(line, "deadband") == 0) lookAtDeadband = atof(equals + 1);
+		for(int i = 0; i < 2; i++)
+		{
+			size_t prefixLength = strlen(lookAtAxisNames[i]);
+			if(strncmp(line, lookAtAxisNames[i], prefixLength) == 0) motionLookAtParseAxis(&lookAtAxes[i], line + prefixLength, equals + 1);
+		}
+	}
+	fclose(file);
+
+	for(int i = 0; i < 2; i++)
+	{
+		if(lookAtAxes[i].ID < 0 || lookAtAxes[i].pointCount < 2)
+		{
+			fprintf(stderr, "Look-at calibration %s needs an id and at least two points for %s\n", calibrationFile, lookAtAxisNames[i]);
+			return -1;
+		}
+		lookAtAxes[i].goal = lookAtAxes[i].center;
+	}
+
+	lookAtFrameCenter[0] = frameWidth * 0.5f;
+	lookAtFrameCenter[1] = frameHeight * 0.5f;
+	lookAtLastUpdate = motionLookAtNow();
+	lookAtLastMeasured = 0;
+	lookAtHistoryCount = 0;
+	lookAtHistoryNext = 0;
+	motionLookAtRecord(lookAtLastUpdate);
+	lookAtEnabled = 1;
+	motionLookAtSend(1);
+	return 0;
+}
+
+void motionLookAtUpdate(int found, float x, float y, uint64_t measured)
+{
+	if(!lookAtEnabled) return;
+	if(!found || measured == lookAtLastMeasured) return;
+	lookAtLastMeasured = measured;
+
+	uint64_t now = motionLookAtNow();
+	float interval = (now - lookAtLastUpdate) / 1e9f;
+	if(interval > LOOK_AT_MAX_INTERVAL_SECONDS) interval = LOOK_AT_MAX_INTERVAL_SECONDS;
+	lookAtLastUpdate = now;
+
+	float offsets[2] = {x - lookAtFrameCenter[0], y - lookAtFrameCenter[1]};
+	for(int i = 0; i < 2; i++)
+	{
+		LOOK_AT_AXIS *axis = &lookAtAxes[i];
+		float aim = motionLookAtGoalAt(i, measured);
+		if(fabsf(offsets[i]) > lookAtDeadband) aim += lookAtGain * motionLookAtCorrection(axis, offsets[i]);
+
+		float limit = axis->rate * interval;
+		float step = fminf(fmaxf(aim - axis->goal, -limit), limit);
+		axis->goal = fminf(fmaxf(axis->goal + step, axis->minimum), axis->maximum);
+	}
+	motionLookAtRecord(now);
+	motionLookAtSend(0);
+}
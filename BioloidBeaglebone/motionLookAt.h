@@ -0,0 +1,94 @@
+/** @file motionLookAt.h
+ *  @brief Function prototypes for pointing the head at the tracked target.
+ *
+ *  These are the prototypes for functions that: load a calibration for the pan and
+ *  tilt joints, turn where the target is in the frame into goals for those joints, and
+ *  stream the goals to PRU0 through the joint setpoint block so the head follows the
+ *  target at frame rate without any page being played.
+ *
+ *  Each axis is calibrated with a lookup of how far (in servo units) the joint has to
+ *  turn to bring something the given number of full frame pixels (so the table holds
+ *  whatever window or decimation is captured) from the frame centre onto the centre,
+ *  interpolated linearly between points, so lens distortion and the camera
+ *  being mounted upside down are both just part of the table. Each new measurement
+ *  sets the goal to the goal the head had when its frame was captured plus a fraction
+ *  of that turn, and the change is limited to the axis' rate so a bad detection can't
+ *  fling the head around. The calibration file has one key=value per line:
+ *
+ *		pan.id=19				servo ID
+ *		pan.min=312				lowest goal allowed
+ *		pan.max=712				highest goal allowed
+ *		pan.center=512			goal to start from
+ *		pan.rate=300			most servo units per second the goal may move
+ *		pan.speed=0				AX-12 moving speed to send with the goal
+ *		pan.point=-160,-154		pixels from centre, servo units (at least two)
+ *		tilt.*					the same for the tilt joint
+ *		gain=0.3				fraction of the correction applied per measurement
+ *		deadband=4				pixels from centre that count as centred
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef MOTIONLOOKAT_H_
+#define MOTIONLOOKAT_H_
+
+#include <stdint.h>
+
+#define LOOK_AT_MAX_POINTS				16
+#define LOOK_AT_DEFAULT_GAIN			0.3f
+#define LOOK_AT_DEFAULT_DEADBAND		4.0f
+#define LOOK_AT_DEFAULT_RATE			300.0f
+#define LOOK_AT_MAX_INTERVAL_SECONDS	0.1f
+#define LOOK_AT_HISTORY_LENGTH			64
+
+typedef struct{
+	int ID;
+	int minimum;
+	int maximum;
+	int center;
+	float rate;
+	int speed;
+	int pointCount;
+	float pixels[LOOK_AT_MAX_POINTS];
+	float units[LOOK_AT_MAX_POINTS];
+	float goal;
+} LOOK_AT_AXIS;
+
+/** @brief Loads the calibration and centres the head
+ *
+ *	@param	calibrationFile the calibration file (see above).
+ *	@param	frameWidth the width of the full frame target positions are given in.
+ *	@param	frameHeight the height of the full frame target positions are given in.
+ * 	@return 0 on success, -1 if the file couldn't be read or an axis has no ID or fewer
+ * 			than two points.
+ *
+ */
+int motionLookAtInitialize(const char *calibrationFile, int frameWidth, int frameHeight);
+
+/** @brief Moves the head goals toward the target
+ *
+ * 	Call once per pass of the main loop. Only a measurement newer than the last one
+ * 	used moves the goals; when there is no target, or the target hasn't been seen in a
+ * 	new frame, the goals are held where they are. The target's offset was measured
+ * 	with the head where it was when the frame was captured, so the correction is added
+ * 	to the goal from then rather than to the current one, which would count it again
+ * 	for every update the head has already made since. New goals are only sent when
+ * 	one of them changes by a whole unit.
+ *
+ *	@param	found whether there is a target.
+ *	@param	x the target's position across the frame captured at measured, in full
+ *			frame pixels.
+ *	@param	y the target's position down the frame captured at measured, in full
+ *			frame pixels.
+ *	@param	measured the capture time of the frame the target was last measured in,
+ *			in nanoseconds on CLOCK_MONOTONIC.
+ * 	@return void.
+ *
+ */
+void motionLookAtUpdate(int found, float x, float y, uint64_t measured);
+
+#endif /* MOTIONLOOKAT_H_ */
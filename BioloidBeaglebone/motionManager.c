@@ -27,6 +27,7 @@ PRU_INTEROP_0_DATA* PRUInterop0Data;
 MOTION_PAGE *motionPages;
 volatile uint8_t *motionInstruction;
 volatile uint8_t *motionArgument;
+JOINT_SETPOINTS *jointSetpoints;
 
 void motionManagerInitialize(const char *motionFile)
 {
@@ -35,6 +36,7 @@ void motionManagerInitialize(const char *motionFile)
 	motionPages = PRUInterop0Data->motionPages;
 	motionInstruction = &(PRUInterop0Data->motionInstruction);
 	motionArgument = &(PRUInterop0Data->motionArgument);
+	jointSetpoints = &(PRUInterop0Data->jointSetpoints);
 
 	motionManagerLoadFile(motionFile);
 
@@ -42,6 +44,8 @@ void motionManagerInitialize(const char *motionFile)
 
 void motionManagerProcess(char key)
 {
+	if(motionInstruction == NULL) return;
+
 	switch(key)
 	{
 		case '1':
@@ -61,6 +65,25 @@ void motionManagerProcess(char key)
 	}
 }
 
+void motionManagerSetJointGoals(const uint8_t *IDs, const uint16_t *goalPositions, const uint16_t *movingSpeeds, int count)
+{
+	if(jointSetpoints == NULL) return;
+	if(count > MAX_JOINT_SETPOINTS) count = MAX_JOINT_SETPOINTS;
+
+	uint32_t sequence = jointSetpoints->sequence;
+	jointSetpoints->sequence = sequence + 1;
+	__sync_synchronize();
+	for(int i = 0; i < count; i++)
+	{
+		jointSetpoints->IDs[i] = IDs[i];
+		jointSetpoints->goalPositions[i] = goalPositions[i];
+		jointSetpoints->movingSpeeds[i] = movingSpeeds[i];
+	}
+	jointSetpoints->count = count;
+	__sync_synchronize();
+	jointSetpoints->sequence = sequence + 2;
+}
+
 void motionManagerLoadFile(const char *filename)
 {
 	FILE *motionFile;
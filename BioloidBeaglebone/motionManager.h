@@ -53,6 +53,22 @@ void motionManagerUninitialize();
  */
 void motionManagerProcess(char key);
 
+/** @brief Streams goals for a few joints straight to the motion worker
+ *
+ * 	Writes the goals into the joint setpoint block PRU0 watches, which it sends to the
+ * 	servos as soon as it sees them instead of waiting for a page. Each call replaces the
+ * 	last set; if PRU0 hasn't picked the last set up yet it only ever sees the newest.
+ * 	Nothing happens if the motion subsystem wasn't initialized (when replaying).
+ *
+ *	@param	IDs				The servo IDs.
+ *	@param	goalPositions	The goal position for each servo.
+ *	@param	movingSpeeds	The moving speed for each servo (0 is as fast as it can).
+ *	@param	count			The number of servos, at most MAX_JOINT_SETPOINTS.
+ * 	@return void.
+ *
+ */
+void motionManagerSetJointGoals(const uint8_t *IDs, const uint16_t *goalPositions, const uint16_t *movingSpeeds, int count);
+
 /** @brief A function to load a motion file from file system
  *
  * 	This function opens a motion file in the file system and does a binary read
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <err.h>
 #include <errno.h>
+#include <sys/mman.h>
 
 #include "pru.h"
 #include "fileParse.h"
@@ -30,6 +31,7 @@ void *pruExternalMemoryVirtual;
 
 PRU_INTEROP_0_DATA *PRUInterop0DataVirtual;
 PRU_INTEROP_1_DATA *PRUInterop1DataVirtual;
+volatile PRU_INTEROP_1_HANDSHAKE *PRUInterop1HandshakeVirtual;
 
 PRU_INTEROP_0_DATA *getPRUInterop0Data()
 {
@@ -41,6 +43,30 @@ PRU_INTEROP_1_DATA *getPRUInterop1Data()
 	return PRUInterop1DataVirtual;
 }
 
+volatile PRU_INTEROP_1_HANDSHAKE *getPRUInterop1Handshake()
+{
+	return PRUInterop1HandshakeVirtual;
+}
+
+void setPRUInterop1Data(PRU_INTEROP_1_DATA *data)
+{
+	PRUInterop1DataVirtual = data;
+}
+
+/*
+ * The PRU subsystem's shared RAM is at a fixed physical address, so it is mapped
+ * straight from /dev/mem rather than found through a resource table.
+ */
+static volatile PRU_INTEROP_1_HANDSHAKE *mapPRUInterop1Handshake()
+{
+	int fd = open("/dev/mem", (O_RDWR | O_SYNC));
+	if(fd < 0) err(1, "Could not open /dev/mem for the PRU shared RAM");
+	void *sharedRAM = mmap(NULL, PRU_SHARED_RAM_BYTES, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, PRU_SHARED_RAM_HOST_ADDRESS);
+	close(fd);
+	if(sharedRAM == MAP_FAILED) err(1, "Could not map the PRU shared RAM");
+	return (volatile PRU_INTEROP_1_HANDSHAKE *)sharedRAM;
+}
+
 void initializePRU(const char *PRU_0_Firmware, const char *PRU_1_Firmware)
 {
 	configurePRU_0(PRU_0_Firmware);
@@ -50,6 +76,7 @@ void initializePRU(const char *PRU_0_Firmware, const char *PRU_1_Firmware)
 
 	PRUInterop0DataVirtual = parseFile("/sys/kernel/debug/remoteproc/remoteproc1/resource_table");
 	PRUInterop1DataVirtual = parseFile("/sys/kernel/debug/remoteproc/remoteproc2/resource_table");
+	PRUInterop1HandshakeVirtual = mapPRUInterop1Handshake();
 
 }
 
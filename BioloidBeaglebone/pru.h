@@ -29,6 +29,29 @@
 PRU_INTEROP_0_DATA *getPRUInterop0Data();
 PRU_INTEROP_1_DATA *getPRUInterop1Data();
 
+/** @brief Gets a pointer to the PRU1 handshake in the PRU subsystem's shared RAM
+ *
+ * 	The host releases each frame to PRU1 here (see PRU_INTEROP_1_HANDSHAKE) rather
+ * 	than in the driver allocated memory.
+ *
+ * 	@return the handshake, or NULL when PRU1 is stood in for (setPRUInterop1Data) and
+ * 			the image ready flag alone is the handshake.
+ *
+ */
+volatile PRU_INTEROP_1_HANDSHAKE *getPRUInterop1Handshake();
+
+/** @brief Replaces the PRU1 driver allocated memory with a stand-in
+ *
+ * 	Used when there is no PRU1 to talk to (replaying a recording, for instance), so
+ * 	that getPRUInterop1Data hands out memory that something else fills in following
+ * 	the same handshake. Call this instead of initializePRU.
+ *
+ *	@param	data the stand-in memory.
+ * 	@return void.
+ *
+ */
+void setPRUInterop1Data(PRU_INTEROP_1_DATA *data);
+
 /** @brief Initializes the PRU subsystem.
  *
  * 	We start by calling some setup functions of the prussdrv TI (Texas Instruments) provided
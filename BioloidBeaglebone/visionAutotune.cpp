@@ -0,0 +1,256 @@
+/** @file visionAutotune.cpp
+ *  @brief Functions for choosing and persisting how the networks are run.
+ *
+ *  OpenCV 3.4 has no way to ask which backends and targets it was built with, so we
+ *  just try each combination and treat an exception on the first forward pass as
+ *  'not available'. Everything a candidate needs per frame (preprocessing plan,
+ *  detection arenas) is set up before its timed loop so only the work production
+ *  would do each frame is measured.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "visionAutotune.hpp"
+#include "visionPreprocess.hpp"
+#include "visionDetections.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace cv::dnn;
+
+typedef struct{
+	int id;
+	const char *name;
+} VISION_AUTOTUNE_OPTION;
+
+static const VISION_AUTOTUNE_OPTION backends[] = {
+	{DNN_BACKEND_OPENCV, "opencv"},
+	{DNN_BACKEND_HALIDE, "halide"},
+	{DNN_BACKEND_INFERENCE_ENGINE, "inference_engine"}
+};
+
+static const VISION_AUTOTUNE_OPTION targets[] = {
+	{DNN_TARGET_CPU, "cpu"},
+	{DNN_TARGET_OPENCL, "opencl"},
+	{DNN_TARGET_OPENCL_FP16, "opencl_fp16"}
+};
+
+/*
+ * Largest first; the first entry is the reference everything else is compared with.
+ * Darknet resolutions have to be multiples of 32.
+ */
+static const Size caffeResolutions[] = {Size(300, 300), Size(320, 240), Size(256, 192), Size(224, 168), Size(160, 120)};
+static const Size darknetResolutions[] = {Size(416, 416), Size(320, 320), Size(256, 256), Size(224, 224), Size(192, 192), Size(160, 160), Size(128, 128)};
+
+#define ARRAY_COUNT(array)				(sizeof(array) / sizeof((array)[0]))
+#define AGREEMENT_MIN_OVERLAP			0.5f
+
+static void visionAutotuneParseLine(const string &line, const char *prefix, VISION_NETWORK_CONFIG *config)
+{
+	size_t prefixLength = strlen(prefix);
+	size_t equals = line.find('=');
+	if(equals == string::npos || line.compare(0, prefixLength, prefix) != 0) return;
+
+	string key = line.substr(prefixLength, equals - prefixLength);
+	int value = atoi(line.c_str() + equals + 1);
+
+	if(key == "backend") config->backend = value;
+	else if(key == "target") config->target = value;
+	else if(key == "width") config->inputSize.width = value;
+	else if(key == "height") config->inputSize.height = value;
+}
+
+bool visionAutotuneLoadConfig(const char *configFile, VISION_NETWORK_CONFIG *caffe, VISION_NETWORK_CONFIG *darknet)
+{
+	ifstream file(configFile);
+	if(!file.is_open()) return false;
+
+	string line;
+	while(getline(file, line))
+	{
+		visionAutotuneParseLine(line, "caffe.", caffe);
+		visionAutotuneParseLine(line, "darknet.", darknet);
+	}
+	return true;
+}
+
+bool visionAutotuneSaveConfig(const char *configFile, const VISION_NETWORK_CONFIG *caffe, const VISION_NETWORK_CONFIG *darknet)
+{
+	FILE *file = fopen(configFile, "w");
+	if(!file) return false;
+
+	const char *prefixes[2] = {"caffe", "darknet"};
+	const VISION_NETWORK_CONFIG *configs[2] = {caffe, darknet};
+	for(int i = 0; i < 2; i++)
+	{
+		fprintf(file, "%s.backend=%d\n", prefixes[i], configs[i]->backend);
+		fprintf(file, "%s.target=%d\n", prefixes[i], configs[i]->target);
+		fprintf(file, "%s.width=%d\n", prefixes[i], configs[i]->inputSize.width);
+		fprintf(file, "%s.height=%d\n", prefixes[i], configs[i]->inputSize.height);
+	}
+	fclose(file);
+	return true;
+}
+
+int visionAutotuneLoadFrames(const char *directory, Size frameSize, vector<Mat> &frames)
+{
+	vector<String> files;
+	glob(String(directory) + "/*", files, false);
+
+	int loaded = 0;
+	for(size_t i = 0; i < files.size(); i++)
+	{
+		Mat frame = imread(files[i], IMREAD_COLOR);
+		if(frame.empty()) continue;
+		if(frame.size() != frameSize) resize(frame, frame, frameSize, 0, 0, INTER_AREA);
+		frames.push_back(frame);
+		loaded++;
+	}
+	return loaded;
+}
+
+static void visionAutotuneDetect(Net &net,
+									VISION_NETWORK_TYPE type,
+									const vector<String> &outputNames,
+									VISION_PREPROCESS *plan,
+									const Mat &frame,
+									float confidence,
+									float nmsThreshold,
+									vector<Mat> &outputs,
+									VISION_DETECTIONS *detections)
+{
+	net.setInput(visionPreprocessRun(plan, frame));
+	if(type == VISION_NETWORK_CAFFE)
+	{
+		Mat output = net.forward();
+		visionDetectionsDecodeSSD(output, confidence, frame.size(), detections);
+	}
+	else
+	{
+		net.forward(outputs, outputNames);
+		visionDetectionsDecodeDarknet(outputs, confidence, frame.size(), detections);
+		visionDetectionsNMS(detections, nmsThreshold);
+	}
+}
+
+static float visionAutotuneAgreement(const VISION_DETECTIONS *reference, const VISION_DETECTIONS *candidate)
+{
+	bool used[VISION_DETECTIONS_MAX] = {false};
+	int matches = 0;
+
+	if(reference->keptCount == 0 && candidate->keptCount == 0) return 1.0f;
+
+	for(int i = 0; i < reference->keptCount; i++)
+	{
+		const int r = reference->kept[i];
+		const Rect &referenceBox = reference->box[r];
+		for(int j = 0; j < candidate->keptCount; j++)
+		{
+			const int c = candidate->kept[j];
+			if(used[j] || candidate->classId[c] != reference->classId[r]) continue;
+
+			Rect overlap = referenceBox & candidate->box[c];
+			float combined = (float)(referenceBox.area() + candidate->box[c].area() - overlap.area());
+			if(combined > 0 && overlap.area() >= AGREEMENT_MIN_OVERLAP * combined)
+			{
+				used[j] = true;
+				matches++;
+				break;
+			}
+		}
+	}
+
+	return (float)matches / (float)max(reference->keptCount, candidate->keptCount);
+}
+
+void visionAutotuneNetwork(Net &net,
+							VISION_NETWORK_TYPE type,
+							const vector<String> &outputNames,
+							const vector<Mat> &frames,
+							float confidence,
+							float nmsThreshold,
+							float minAgreement,
+							VISION_NETWORK_CONFIG *chosen)
+{
+	const Size *resolutions = (type == VISION_NETWORK_CAFFE) ? caffeResolutions : darknetResolutions;
+	const size_t resolutionCount = (type == VISION_NETWORK_CAFFE) ? ARRAY_COUNT(caffeResolutions) : ARRAY_COUNT(darknetResolutions);
+	const char *networkName = (type == VISION_NETWORK_CAFFE) ? "caffe" : "darknet";
+
+	vector<VISION_DETECTIONS> reference(frames.size());
+	VISION_DETECTIONS candidate;
+	VISION_PREPROCESS plan;
+	vector<Mat> outputs;
+	double bestMilliseconds = -1;
+	bool haveReference = false;
+
+	if(frames.empty()) return;
+
+	printf("%-8s %-17s %-12s %-9s %10s %10s\n", "network", "backend", "target", "input", "ms/frame", "agreement");
+
+	for(size_t b = 0; b < ARRAY_COUNT(backends); b++)
+	{
+		for(size_t t = 0; t < ARRAY_COUNT(targets); t++)
+		{
+			for(size_t r = 0; r < resolutionCount; r++)
+			{
+				visionPreprocessInitialize(&plan, frames[0].size(), resolutions[r], 0.007843f, 127.5f, VISION_PREPROCESS_NETWORK_SWAP_RB);
+				net.setPreferableBackend(backends[b].id);
+				net.setPreferableTarget(targets[t].id);
+
+				try
+				{
+					visionAutotuneDetect(net, type, outputNames, &plan, frames[0], confidence, nmsThreshold, outputs, &candidate);
+				}
+				catch(const cv::Exception &)
+				{
+					printf("%-8s %-17s %-12s %4dx%-4d %21s\n", networkName, backends[b].name, targets[t].name,
+							resolutions[r].width, resolutions[r].height, "unavailable");
+					break;
+				}
+
+				float agreement = 0;
+				int64 ticks = 0;
+				for(size_t f = 0; f < frames.size(); f++)
+				{
+					VISION_DETECTIONS *detections = haveReference ? &candidate : &reference[f];
+					int64 start = getTickCount();
+					visionAutotuneDetect(net, type, outputNames, &plan, frames[f], confidence, nmsThreshold, outputs, detections);
+					ticks += getTickCount() - start;
+					agreement += haveReference ? visionAutotuneAgreement(&reference[f], &candidate) : 1.0f;
+				}
+				agreement /= frames.size();
+				haveReference = true;
+
+				double milliseconds = (ticks * 1000.0) / (getTickFrequency() * frames.size());
+				printf("%-8s %-17s %-12s %4dx%-4d %10.2f %10.3f\n", networkName, backends[b].name, targets[t].name,
+						resolutions[r].width, resolutions[r].height, milliseconds, agreement);
+
+				if(agreement >= minAgreement && (bestMilliseconds < 0 || milliseconds < bestMilliseconds))
+				{
+					bestMilliseconds = milliseconds;
+					chosen->backend = backends[b].id;
+					chosen->target = targets[t].id;
+					chosen->inputSize = resolutions[r];
+				}
+			}
+		}
+	}
+
+	printf("%s: chose backend %d, target %d, %dx%d (%.2f ms/frame)\n", networkName, chosen->backend, chosen->target,
+			chosen->inputSize.width, chosen->inputSize.height, bestMilliseconds);
+
+	net.setPreferableBackend(chosen->backend);
+	net.setPreferableTarget(chosen->target);
+}
@@ -0,0 +1,105 @@
+/** @file visionAutotune.hpp
+ *  @brief Function prototypes for choosing and persisting how the networks are run.
+ *
+ *  These are the prototypes for functions that: load and save the backend, target and
+ *  input resolution each network should be run with, and benchmark every combination
+ *  of those that OpenCV will accept on this board over a set of frames, so the fastest
+ *  one that still finds what the reference setup finds can be picked and written out
+ *  for the next start.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONAUTOTUNE_HPP_
+#define VISIONAUTOTUNE_HPP_
+
+#include <vector>
+#include "opencv2/core.hpp"
+#include "opencv2/dnn.hpp"
+
+#define VISION_AUTOTUNE_MIN_AGREEMENT		0.9f
+#define VISION_AUTOTUNE_LIVE_FRAMES			30
+
+typedef enum{
+	VISION_NETWORK_CAFFE,
+	VISION_NETWORK_DARKNET
+} VISION_NETWORK_TYPE;
+
+typedef struct{
+	int backend;
+	int target;
+	cv::Size inputSize;
+} VISION_NETWORK_CONFIG;
+
+/** @brief Reads the persisted network configuration.
+ *
+ * 	The file is plain 'key=value' lines (caffe.backend, caffe.target, caffe.width,
+ * 	caffe.height, and the same for darknet). Keys that are missing leave the
+ * 	corresponding field as it was, so callers should fill in defaults first.
+ *
+ *	@param	configFile the file to read.
+ *	@param	caffe the Caffe network's configuration to update.
+ *	@param	darknet the Darknet network's configuration to update.
+ * 	@return true if the file could be opened.
+ *
+ */
+bool visionAutotuneLoadConfig(const char *configFile, VISION_NETWORK_CONFIG *caffe, VISION_NETWORK_CONFIG *darknet);
+
+/** @brief Writes the network configuration in the format visionAutotuneLoadConfig reads.
+ *
+ *	@param	configFile the file to write.
+ *	@param	caffe the Caffe network's configuration.
+ *	@param	darknet the Darknet network's configuration.
+ * 	@return true if the file could be written.
+ *
+ */
+bool visionAutotuneSaveConfig(const char *configFile, const VISION_NETWORK_CONFIG *caffe, const VISION_NETWORK_CONFIG *darknet);
+
+/** @brief Loads the frames to tune on from a directory of images.
+ *
+ * 	Every image OpenCV can read in the directory is loaded and resized to frameSize if
+ * 	it isn't already.
+ *
+ *	@param	directory the directory holding the recorded frames.
+ *	@param	frameSize the size of the frames the PRU delivers.
+ *	@param	frames the vector the frames are appended to.
+ * 	@return the number of frames loaded.
+ *
+ */
+int visionAutotuneLoadFrames(const char *directory, cv::Size frameSize, std::vector<cv::Mat> &frames);
+
+/** @brief Benchmarks a network over every backend/target/resolution it will run with.
+ *
+ * 	The first candidate (the OpenCV backend on the CPU at the largest resolution) is
+ * 	the reference. Each other candidate is timed over all the frames, preprocessing and
+ * 	forward pass together, and its detections are compared with the reference's: a
+ * 	detection agrees if the other side has one of the same class overlapping it by at
+ * 	least half. A line per candidate is printed, and the fastest candidate whose
+ * 	agreement is at least minAgreement is returned in chosen. The network is left set
+ * 	up with the chosen backend and target.
+ *
+ *	@param	net the loaded network.
+ *	@param	type which kind of network it is, so we know how to decode it.
+ *	@param	outputNames the output layers to run to (Darknet), empty for the default.
+ *	@param	frames the frames to run.
+ *	@param	confidence the confidence threshold used in production.
+ *	@param	nmsThreshold the NMS threshold used in production (Darknet only).
+ *	@param	minAgreement the lowest acceptable agreement with the reference.
+ *	@param	chosen the configuration picked.
+ * 	@return void.
+ *
+ */
+void visionAutotuneNetwork(cv::dnn::Net &net,
+							VISION_NETWORK_TYPE type,
+							const std::vector<cv::String> &outputNames,
+							const std::vector<cv::Mat> &frames,
+							float confidence,
+							float nmsThreshold,
+							float minAgreement,
+							VISION_NETWORK_CONFIG *chosen);
+
+#endif /* VISIONAUTOTUNE_HPP_ */
@@ -0,0 +1,541 @@
+/** @file visionBenchmark.cpp
+ *  @brief Offline benchmark of the vision pipeline.
+ *
+ *  A separate executable (make benchmark) that runs the threshold, Caffe and Darknet
+ *  modes over a set of 320x240 frames without the PRUs, the servos or any windows,
+ *  and reports where each frame's time goes. The frames come from a directory of
+ *  images, a recording made with --record, or are generated. Each mode is timed in
+ *  the same stages the vision manager goes through: preprocess, forward (broken down
+ *  per layer with Net::getPerfProfile), postprocess (decode and NMS) and draw. The
+ *  distribution of each stage, the throughput and the peak resident set size are
+ *  written out as JSON so runs on different builds can be compared by a script.
+ *
+ *  The stage code is the same code the vision manager runs (visionPreprocess,
+ *  visionDetections), so what is measured here is what runs on the robot.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/dnn.hpp"
+#include "visionDetections.hpp"
+#include "visionPreprocess.hpp"
+#include "visionAutotune.hpp"
+#include "frameRecording.hpp"
+
+extern "C"
+{
+#include "PRUInterop.h"
+#include "pru.h"
+}
+
+using namespace std;
+using namespace cv;
+using namespace cv::dnn;
+
+#define BENCHMARK_SYNTHETIC_FRAMES		100
+#define BENCHMARK_WARMUP_FRAMES			3
+#define BENCHMARK_SYNTHETIC_SEED		0x42424242
+
+typedef enum{
+	STAGE_PREPROCESS,
+	STAGE_FORWARD,
+	STAGE_POSTPROCESS,
+	STAGE_DRAW,
+	STAGE_TOTAL,
+	STAGE_COUNT
+} BENCHMARK_STAGE;
+
+static const char *stageNames[STAGE_COUNT] = {"preprocess", "forward", "postprocess", "draw", "total"};
+
+typedef struct{
+	const char *mode;
+	VISION_NETWORK_CONFIG config;
+	vector<double> milliseconds[STAGE_COUNT];
+	vector<String> layerNames;
+	vector<double> layerMilliseconds;
+	double wallSeconds;
+	long detections;
+	long peakResidentKilobytes;
+} BENCHMARK_RESULT;
+
+typedef struct{
+	const char *modelFile;
+	const char *configFile;
+	const char *namesFile;
+	float confidence;
+	float nmsThreshold;
+	VISION_NETWORK_CONFIG config;
+} BENCHMARK_NETWORK;
+
+static const char *usage =
+	"Usage: visionBenchmark [--frames Directory|Recording|synthetic[:Count]] [--mode threshold|caffe|darknet|all]\n"
+	"                       [--caffe-proto File --caffe-model File [--caffe-names File] [--caffe-confidence Value]]\n"
+	"                       [--darknet-cfg File --darknet-weights File [--darknet-names File]\n"
+	"                        [--darknet-confidence Value] [--darknet-nms Value]]\n"
+	"                       [--vision-config File] [--warmup Frames] [--repeat Passes] [--output File]\n";
+
+static const struct option longOptions[] =
+{
+	{"frames",				required_argument,	NULL,	'f'},
+	{"mode",				required_argument,	NULL,	'M'},
+	{"caffe-proto",			required_argument,	NULL,	'p'},
+	{"caffe-model",			required_argument,	NULL,	'c'},
+	{"caffe-names",			required_argument,	NULL,	'n'},
+	{"caffe-confidence",	required_argument,	NULL,	'C'},
+	{"darknet-cfg",			required_argument,	NULL,	'g'},
+	{"darknet-weights",		required_argument,	NULL,	'w'},
+	{"darknet-names",		required_argument,	NULL,	'N'},
+	{"darknet-confidence",	required_argument,	NULL,	'D'},
+	{"darknet-nms",			required_argument,	NULL,	'S'},
+	{"vision-config",		required_argument,	NULL,	'v'},
+	{"warmup",				required_argument,	NULL,	'W'},
+	{"repeat",				required_argument,	NULL,	'r'},
+	{"output",				required_argument,	NULL,	'o'},
+	{NULL,					0,					NULL,	0}
+};
+
+static double benchmarkMilliseconds(int64 start, int64 end)
+{
+	return (end - start) * 1000.0 / getTickFrequency();
+}
+
+static long benchmarkPeakResidentKilobytes()
+{
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return usage.ru_maxrss;
+}
+
+/*
+ * Plays the recording through the replay stand-in for PRU1, at full speed, and keeps
+ * a copy of every frame it hands over.
+ */
+static int benchmarkLoadRecording(const char *filename, vector<Mat> &frames)
+{
+	if(frameReplayStart(filename, 0) != 0) return 0;
+
+	PRU_INTEROP_1_DATA *PRUInterop1Data = getPRUInterop1Data();
+	volatile uint32_t *imageReadyFlag = &(PRUInterop1Data->imageReadyFlag);
+	Mat frame(Size(PRUInterop1Data->captureSensor.columns, PRUInterop1Data->captureSensor.rows), CV_8UC3, (void *)(PRUInterop1Data->imageData));
+
+	while(!frameReplayFinished())
+	{
+		if(*imageReadyFlag == IMAGE_NOT_READY)
+		{
+			usleep(100);
+			continue;
+		}
+		frames.push_back(frame.clone());
+		*imageReadyFlag = IMAGE_NOT_READY;
+	}
+	frameReplayStop();
+	return frames.size();
+}
+
+/*
+ * Dark noise with a ball of the default threshold colour rolling across it, so every
+ * mode has something to find and the frames aren't trivially compressible.
+ */
+static int benchmarkSyntheticFrames(int count, Size frameSize, vector<Mat> &frames)
+{
+	RNG rng(BENCHMARK_SYNTHETIC_SEED);
+
+	for(int i = 0; i < count; i++)
+	{
+		Mat frame(frameSize, CV_8UC3);
+		rng.fill(frame, RNG::UNIFORM, Scalar::all(0), Scalar::all(64));
+		Point center((i * 7) % frameSize.width, frameSize.height / 2 + ((i * 3) % 40) - 20);
+		circle(frame, center, 20, Scalar(150, 40, 180), -1, 8, 0);
+		frames.push_back(frame);
+	}
+	return count;
+}
+
+static int benchmarkLoadFrames(const char *source, Size frameSize, vector<Mat> &frames)
+{
+	struct stat sourceStatus;
+
+	if(strncmp(source, "synthetic", 9) == 0)
+	{
+		int count = (source[9] == ':') ? atoi(source + 10) : BENCHMARK_SYNTHETIC_FRAMES;
+		return benchmarkSyntheticFrames(count, frameSize, frames);
+	}
+	if(stat(source, &sourceStatus) != 0) return 0;
+	if(S_ISDIR(sourceStatus.st_mode)) return visionAutotuneLoadFrames(source, frameSize, frames);
+	return benchmarkLoadRecording(source, frames);
+}
+
+static void benchmarkLoadNames(const char *namesFile, vector<string> &classes)
+{
+	string nameLine;
+
+	if(namesFile == NULL) return;
+	ifstream file(namesFile);
+	while (getline(file, nameLine)) classes.push_back(nameLine);
+}
+
+static void benchmarkResultInitialize(BENCHMARK_RESULT *result, const char *mode)
+{
+	result->mode = mode;
+	result->config.backend = DNN_BACKEND_DEFAULT;
+	result->config.target = DNN_TARGET_CPU;
+	result->config.inputSize = Size(0, 0);
+	result->wallSeconds = 0;
+	result->detections = 0;
+	result->peakResidentKilobytes = 0;
+	for(int s = 0; s < STAGE_COUNT; s++) result->milliseconds[s].clear();
+	result->layerNames.clear();
+	result->layerMilliseconds.clear();
+}
+
+/*
+ * The same steps as visionManagerProcessThreshold: copy the frame, mask the colour,
+ * take the moments, mark the centroid.
+ */
+static void benchmarkThreshold(const vector<Mat> &frames, int warmup, int repeat, BENCHMARK_RESULT *result)
+{
+	const Scalar thresholdLow = Scalar(60, 0, 100);
+	const Scalar thresholdHigh = Scalar(200, 80, 255);
+	Mat display;
+	Mat processing;
+
+	benchmarkResultInitialize(result, "threshold");
+	result->config.inputSize = frames[0].size();
+
+	int64 wallStart = 0;
+	for(int pass = 0, frame = 0; pass < repeat; frame++)
+	{
+		if(frame == (int)frames.size())
+		{
+			frame = 0;
+			pass++;
+			if(pass == repeat) break;
+		}
+		bool measured = (warmup-- <= 0);
+		if(measured && wallStart == 0) wallStart = getTickCount();
+
+		int64 t0 = getTickCount();
+		display = frames[frame].clone();
+		int64 t1 = getTickCount();
+		inRange(display, thresholdLow, thresholdHigh, processing);
+		int64 t2 = getTickCount();
+		cv::Moments moments = cv::moments(processing, false);
+		int64 t3 = getTickCount();
+		if(moments.m00 > 1000000)
+		{
+			Point position(moments.m10 / moments.m00, moments.m01 / moments.m00);
+			rectangle(display, Point(position.x - 5, position.y - 5), Point(position.x + 5, position.y + 5), Scalar(0, 255, 0), 1, 8, 0);
+			putText(display, format("pos: %d, %d", position.x, position.y), Point(position.x + 10, position.y + 5), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+			if(measured) result->detections++;
+		}
+		int64 t4 = getTickCount();
+
+		if(!measured) continue;
+		result->milliseconds[STAGE_PREPROCESS].push_back(benchmarkMilliseconds(t0, t1));
+		result->milliseconds[STAGE_FORWARD].push_back(benchmarkMilliseconds(t1, t2));
+		result->milliseconds[STAGE_POSTPROCESS].push_back(benchmarkMilliseconds(t2, t3));
+		result->milliseconds[STAGE_DRAW].push_back(benchmarkMilliseconds(t3, t4));
+		result->milliseconds[STAGE_TOTAL].push_back(benchmarkMilliseconds(t0, t4));
+	}
+	result->wallSeconds = (getTickCount() - wallStart) / getTickFrequency();
+	result->peakResidentKilobytes = benchmarkPeakResidentKilobytes();
+}
+
+/*
+ * The same steps as visionManagerProcessCaffe/Darknet. The frame is copied to the
+ * canvas outside the timed region, since on the robot the drawing is done in place.
+ */
+static bool benchmarkNetwork(VISION_NETWORK_TYPE type,
+								const BENCHMARK_NETWORK *network,
+								const vector<Mat> &frames,
+								int warmup,
+								int repeat,
+								BENCHMARK_RESULT *result)
+{
+	static VISION_DETECTIONS detections;
+	VISION_PREPROCESS plan;
+	vector<Mat> outputs;
+	vector<String> outputNames;
+	vector<string> classes;
+	vector<double> layerTicks;
+	Mat output;
+	Mat canvas;
+	Net net;
+
+	benchmarkResultInitialize(result, (type == VISION_NETWORK_CAFFE) ? "caffe" : "darknet");
+	if(network->modelFile == NULL || network->configFile == NULL) return false;
+
+	try
+	{
+		net = readNet(network->modelFile, network->configFile);
+	}
+	catch(const cv::Exception &)
+	{
+		net = Net();
+	}
+	if(net.empty())
+	{
+		fprintf(stderr, "Could not load the %s network\n", result->mode);
+		return false;
+	}
+	net.setPreferableBackend(network->config.backend);
+	net.setPreferableTarget(network->config.target);
+	result->config = network->config;
+	benchmarkLoadNames(network->namesFile, classes);
+
+	if(type == VISION_NETWORK_DARKNET)
+	{
+		vector<int> unconnectedOutputLayersIndices = net.getUnconnectedOutLayers();
+		vector<String> layerNames = net.getLayerNames();
+		for(size_t i = 0; i < unconnectedOutputLayersIndices.size(); i++) outputNames.push_back(layerNames[unconnectedOutputLayersIndices[i] - 1]);
+	}
+	result->layerNames = net.getLayerNames();
+	result->layerMilliseconds.assign(result->layerNames.size(), 0.0);
+
+	visionPreprocessInitialize(&plan, frames[0].size(), network->config.inputSize, 0.007843f, 127.5f, VISION_PREPROCESS_NETWORK_SWAP_RB);
+
+	int64 wallStart = 0;
+	for(int pass = 0, frame = 0; pass < repeat; frame++)
+	{
+		if(frame == (int)frames.size())
+		{
+			frame = 0;
+			pass++;
+			if(pass == repeat) break;
+		}
+		bool measured = (warmup-- <= 0);
+		if(measured && wallStart == 0) wallStart = getTickCount();
+
+		frames[frame].copyTo(canvas);
+
+		int64 t0 = getTickCount();
+		net.setInput(visionPreprocessRun(&plan, canvas));
+		int64 t1 = getTickCount();
+		if(type == VISION_NETWORK_CAFFE) output = net.forward();
+		else net.forward(outputs, outputNames);
+		int64 t2 = getTickCount();
+		if(type == VISION_NETWORK_CAFFE)
+		{
+			visionDetectionsDecodeSSD(output, network->confidence, canvas.size(), &detections);
+		}
+		else
+		{
+			visionDetectionsDecodeDarknet(outputs, network->confidence, canvas.size(), &detections);
+			visionDetectionsNMS(&detections, network->nmsThreshold);
+		}
+		for(int i = 0; i < detections.count; i++) detections.box[i] = visionPreprocessToFrame(&plan, detections.box[i], canvas.size());
+		int64 t3 = getTickCount();
+		visionDetectionsDraw(canvas, &detections, classes, (type == VISION_NETWORK_CAFFE) ? 10 : 0);
+		int64 t4 = getTickCount();
+
+		if(!measured) continue;
+		result->milliseconds[STAGE_PREPROCESS].push_back(benchmarkMilliseconds(t0, t1));
+		result->milliseconds[STAGE_FORWARD].push_back(benchmarkMilliseconds(t1, t2));
+		result->milliseconds[STAGE_POSTPROCESS].push_back(benchmarkMilliseconds(t2, t3));
+		result->milliseconds[STAGE_DRAW].push_back(benchmarkMilliseconds(t3, t4));
+		result->milliseconds[STAGE_TOTAL].push_back(benchmarkMilliseconds(t0, t4));
+		result->detections += detections.keptCount;
+
+		net.getPerfProfile(layerTicks);
+		for(size_t i = 0; i < layerTicks.size() && i < result->layerMilliseconds.size(); i++)
+		{
+			result->layerMilliseconds[i] += layerTicks[i] * 1000.0 / getTickFrequency();
+		}
+	}
+	result->wallSeconds = (getTickCount() - wallStart) / getTickFrequency();
+	result->peakResidentKilobytes = benchmarkPeakResidentKilobytes();
+
+	size_t measuredFrames = result->milliseconds[STAGE_TOTAL].size();
+	for(size_t i = 0; i < result->layerMilliseconds.size() && measuredFrames > 0; i++) result->layerMilliseconds[i] /= measuredFrames;
+	return true;
+}
+
+static string benchmarkJSONString(const string &text)
+{
+	string quoted = "\"";
+	for(size_t i = 0; i < text.size(); i++)
+	{
+		if(text[i] == '"' || text[i] == '\\') quoted += '\\';
+		if((unsigned char)text[i] >= 0x20) quoted += text[i];
+	}
+	return quoted + "\"";
+}
+
+static double benchmarkPercentile(const vector<double> &sorted, double percentile)
+{
+	size_t rank = (size_t)(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[min(rank, sorted.size() - 1)];
+}
+
+static void benchmarkWriteDistribution(FILE *file, const char *name, const vector<double> &samples, bool last)
+{
+	vector<double> sorted(samples);
+	double sum = 0;
+
+	sort(sorted.begin(), sorted.end());
+	for(size_t i = 0; i < sorted.size(); i++) sum += sorted[i];
+
+	fprintf(file, "        \"%s\": {\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+			name,
+			sum / sorted.size(),
+			sorted.front(),
+			benchmarkPercentile(sorted, 50),
+			benchmarkPercentile(sorted, 90),
+			benchmarkPercentile(sorted, 99),
+			sorted.back(),
+			last ? "" : ",");
+}
+
+static void benchmarkWriteResults(FILE *file, const char *source, int frameCount, int warmup, int repeat, const vector<BENCHMARK_RESULT> &results)
+{
+	fprintf(file, "{\n");
+	fprintf(file, "  \"source\": %s,\n", benchmarkJSONString(source).c_str());
+	fprintf(file, "  \"frames\": %d,\n", frameCount);
+	fprintf(file, "  \"warmup\": %d,\n", warmup);
+	fprintf(file, "  \"repeat\": %d,\n", repeat);
+	fprintf(file, "  \"opencv\": %s,\n", benchmarkJSONString(CV_VERSION).c_str());
+	fprintf(file, "  \"modes\": [\n");
+	for(size_t r = 0; r < results.size(); r++)
+	{
+		const BENCHMARK_RESULT *result = &results[r];
+		size_t measuredFrames = result->milliseconds[STAGE_TOTAL].size();
+
+		fprintf(file, "    {\n");
+		fprintf(file, "      \"mode\": \"%s\",\n", result->mode);
+		fprintf(file, "      \"backend\": %d,\n", result->config.backend);
+		fprintf(file, "      \"target\": %d,\n", result->config.target);
+		fprintf(file, "      \"input\": [%d, %d],\n", result->config.inputSize.width, result->config.inputSize.height);
+		fprintf(file, "      \"measured_frames\": %d,\n", (int)measuredFrames);
+		fprintf(file, "      \"fps\": %.3f,\n", (result->wallSeconds > 0) ? measuredFrames / result->wallSeconds : 0.0);
+		fprintf(file, "      \"detections_per_frame\": %.3f,\n", (double)result->detections / measuredFrames);
+		fprintf(file, "      \"peak_rss_kb\": %ld,\n", result->peakResidentKilobytes);
+		fprintf(file, "      \"stages_ms\": {\n");
+		for(int s = 0; s < STAGE_COUNT; s++) benchmarkWriteDistribution(file, stageNames[s], result->milliseconds[s], s == STAGE_COUNT - 1);
+		fprintf(file, "      },\n");
+		fprintf(file, "      \"layers_ms\": [");
+		for(size_t l = 0; l < result->layerNames.size(); l++)
+		{
+			fprintf(file, "%s\n        {\"name\": %s, \"mean\": %.4f}",
+					(l == 0) ? "" : ",",
+					benchmarkJSONString(result->layerNames[l]).c_str(),
+					result->layerMilliseconds[l]);
+		}
+		fprintf(file, "%s]\n", result->layerNames.empty() ? "" : "\n      ");
+		fprintf(file, "    }%s\n", (r == results.size() - 1) ? "" : ",");
+	}
+	fprintf(file, "  ],\n");
+	fprintf(file, "  \"peak_rss_kb\": %ld\n", benchmarkPeakResidentKilobytes());
+	fprintf(file, "}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *source = "synthetic";
+	const char *mode = "all";
+	const char *visionConfigFile = NULL;
+	const char *outputFile = NULL;
+	int warmup = BENCHMARK_WARMUP_FRAMES;
+	int repeat = 1;
+	int option;
+
+	BENCHMARK_NETWORK caffe = {NULL, NULL, NULL, 0.5f, 0.0f, {DNN_BACKEND_DEFAULT, DNN_TARGET_CPU, Size(320, 240)}};
+	BENCHMARK_NETWORK darknet = {NULL, NULL, NULL, 0.5f, 0.4f, {DNN_BACKEND_DEFAULT, DNN_TARGET_CPU, Size(192, 192)}};
+
+	while((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1)
+	{
+		switch(option)
+		{
+			case 'f': source = optarg; break;
+			case 'M': mode = optarg; break;
+			case 'p': caffe.configFile = optarg; break;
+			case 'c': caffe.modelFile = optarg; break;
+			case 'n': caffe.namesFile = optarg; break;
+			case 'C': caffe.confidence = atof(optarg); break;
+			case 'g': darknet.configFile = optarg; break;
+			case 'w': darknet.modelFile = optarg; break;
+			case 'N': darknet.namesFile = optarg; break;
+			case 'D': darknet.confidence = atof(optarg); break;
+			case 'S': darknet.nmsThreshold = atof(optarg); break;
+			case 'v': visionConfigFile = optarg; break;
+			case 'W': warmup = atoi(optarg); break;
+			case 'r': repeat = max(atoi(optarg), 1); break;
+			case 'o': outputFile = optarg; break;
+			default:
+				fprintf(stderr, "%s", usage);
+				return -1;
+		}
+	}
+
+	if(visionConfigFile != NULL) visionAutotuneLoadConfig(visionConfigFile, &caffe.config, &darknet.config);
+
+	vector<Mat> frames;
+	if(benchmarkLoadFrames(source, Size(IMAGE_COLUMNS_IN_PIXELS_QVGA, IMAGE_ROWS_IN_PIXELS_QVGA), frames) == 0)
+	{
+		fprintf(stderr, "No frames to benchmark from %s\n%s", source, usage);
+		return -1;
+	}
+	fprintf(stderr, "Benchmarking on %d frames from %s\n", (int)frames.size(), source);
+
+	bool all = (strcmp(mode, "all") == 0);
+	vector<BENCHMARK_RESULT> results;
+	BENCHMARK_RESULT result;
+
+	if(all || strcmp(mode, "threshold") == 0)
+	{
+		benchmarkThreshold(frames, warmup, repeat, &result);
+		results.push_back(result);
+	}
+	if((all || strcmp(mode, "caffe") == 0) &&
+		benchmarkNetwork(VISION_NETWORK_CAFFE, &caffe, frames, warmup, repeat, &result))
+	{
+		results.push_back(result);
+	}
+	if((all || strcmp(mode, "darknet") == 0) &&
+		benchmarkNetwork(VISION_NETWORK_DARKNET, &darknet, frames, warmup, repeat, &result))
+	{
+		results.push_back(result);
+	}
+
+	/* The warm up frames come out of the first pass; it may not swallow all of them. */
+	for(size_t r = 0; r < results.size(); r++)
+	{
+		if(results[r].milliseconds[STAGE_TOTAL].empty())
+		{
+			fprintf(stderr, "Warm up (%d frames) leaves nothing to measure\n", warmup);
+			return -1;
+		}
+	}
+	if(results.empty())
+	{
+		fprintf(stderr, "Nothing to benchmark for mode %s\n%s", mode, usage);
+		return -1;
+	}
+
+	FILE *file = (outputFile != NULL) ? fopen(outputFile, "w") : stdout;
+	if(file == NULL)
+	{
+		fprintf(stderr, "Could not write %s\n", outputFile);
+		return -1;
+	}
+	benchmarkWriteResults(file, source, frames.size(), warmup, repeat, results);
+	if(file != stdout) fclose(file);
+	return 0;
+}
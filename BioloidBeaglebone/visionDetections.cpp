@@ -0,0 +1,192 @@
+/** @file visionDetections.cpp
+ *  @brief Functions for decoding and filtering DNN detections.
+ *
+ *  These functions walk the raw float output of the networks directly instead of
+ *  building a cv::Mat header per row and calling minMaxLoc on it, and collect the
+ *  results into a caller owned arena so nothing is allocated per frame. The NMS here
+ *  is a simple O(n^2) greedy pass, which for the box counts these networks produce
+ *  is cheaper than sorting into and out of the vectors cv::dnn::NMSBoxes wants.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <algorithm>
+#include "opencv2/imgproc.hpp"
+#include "visionDetections.hpp"
+
+using namespace std;
+using namespace cv;
+
+#define DARKNET_OBJECTNESS_INDEX		4
+#define DARKNET_FIRST_CLASS_INDEX		5
+
+#define SSD_RECORD_SIZE					7
+#define SSD_CLASS_INDEX					1
+#define SSD_CONFIDENCE_INDEX			2
+#define SSD_LEFT_INDEX					3
+#define SSD_TOP_INDEX					4
+#define SSD_RIGHT_INDEX					5
+#define SSD_BOTTOM_INDEX				6
+
+void visionDetectionsClear(VISION_DETECTIONS *detections)
+{
+	detections->count = 0;
+	detections->dropped = 0;
+	detections->keptCount = 0;
+}
+
+void visionDetectionsDecodeDarknet(const vector<Mat> &outs,
+									float confidenceThreshold,
+									Size imageSize,
+									VISION_DETECTIONS *detections)
+{
+	visionDetectionsClear(detections);
+
+	for(size_t i = 0; i < outs.size(); i++)
+	{
+		const int rows = outs[i].rows;
+		const int cols = outs[i].cols;
+		const float *data = (const float *)outs[i].data;
+
+		for(int j = 0; j < rows; j++, data += cols)
+		{
+			if(data[DARKNET_OBJECTNESS_INDEX] <= confidenceThreshold) continue;
+
+			int classId = 0;
+			float confidence = data[DARKNET_FIRST_CLASS_INDEX];
+			for(int k = DARKNET_FIRST_CLASS_INDEX + 1; k < cols; k++)
+			{
+				if(data[k] > confidence)
+				{
+					confidence = data[k];
+					classId = k - DARKNET_FIRST_CLASS_INDEX;
+				}
+			}
+			if(confidence <= confidenceThreshold) continue;
+
+			if(detections->count == VISION_DETECTIONS_MAX)
+			{
+				detections->dropped++;
+				continue;
+			}
+
+			int width = (int)(data[2] * imageSize.width);
+			int height = (int)(data[3] * imageSize.height);
+			int left = (int)(data[0] * imageSize.width) - width / 2;
+			int top = (int)(data[1] * imageSize.height) - height / 2;
+
+			int n = detections->count++;
+			detections->box[n] = Rect(left, top, width, height);
+			detections->confidence[n] = confidence;
+			detections->classId[n] = classId;
+		}
+	}
+}
+
+void visionDetectionsDecodeSSD(const Mat &output,
+								float confidenceThreshold,
+								Size imageSize,
+								VISION_DETECTIONS *detections)
+{
+	visionDetectionsClear(detections);
+
+	const int records = (int)(output.total() / SSD_RECORD_SIZE);
+	const float *data = (const float *)output.data;
+
+	for(int i = 0; i < records; i++, data += SSD_RECORD_SIZE)
+	{
+		float confidence = data[SSD_CONFIDENCE_INDEX];
+		if(confidence <= confidenceThreshold) continue;
+
+		if(detections->count == VISION_DETECTIONS_MAX)
+		{
+			detections->dropped++;
+			continue;
+		}
+
+		int left = (int)(data[SSD_LEFT_INDEX] * imageSize.width);
+		int top = (int)(data[SSD_TOP_INDEX] * imageSize.height);
+		int width = (int)(data[SSD_RIGHT_INDEX] * imageSize.width) - left;
+		int height = (int)(data[SSD_BOTTOM_INDEX] * imageSize.height) - top;
+
+		int n = detections->count++;
+		detections->box[n] = Rect(left, top, width, height);
+		detections->confidence[n] = confidence;
+		detections->classId[n] = (int)data[SSD_CLASS_INDEX];
+		detections->kept[detections->keptCount++] = n;
+	}
+}
+
+void visionDetectionsNMS(VISION_DETECTIONS *detections, float nmsThreshold)
+{
+	int order[VISION_DETECTIONS_MAX];
+	bool suppressed[VISION_DETECTIONS_MAX];
+	const int count = detections->count;
+
+	for(int i = 0; i < count; i++)
+	{
+		int index = i;
+		int position = i;
+		while(position > 0 && detections->confidence[order[position - 1]] < detections->confidence[index])
+		{
+			order[position] = order[position - 1];
+			position--;
+		}
+		order[position] = index;
+		suppressed[i] = false;
+	}
+
+	detections->keptCount = 0;
+	for(int i = 0; i < count; i++)
+	{
+		if(suppressed[i]) continue;
+
+		const int best = order[i];
+		const Rect &bestBox = detections->box[best];
+		const int bestArea = bestBox.width * bestBox.height;
+		detections->kept[detections->keptCount++] = best;
+
+		for(int j = i + 1; j < count; j++)
+		{
+			if(suppressed[j]) continue;
+
+			const int candidate = order[j];
+			if(detections->classId[candidate] != detections->classId[best]) continue;
+
+			const Rect &candidateBox = detections->box[candidate];
+			int overlapWidth = min(bestBox.x + bestBox.width, candidateBox.x + candidateBox.width) - max(bestBox.x, candidateBox.x);
+			int overlapHeight = min(bestBox.y + bestBox.height, candidateBox.y + candidateBox.height) - max(bestBox.y, candidateBox.y);
+			if(overlapWidth <= 0 || overlapHeight <= 0) continue;
+
+			float intersection = (float)(overlapWidth * overlapHeight);
+			float combined = (float)(bestArea + candidateBox.width * candidateBox.height) - intersection;
+			if(intersection > nmsThreshold * combined) suppressed[j] = true;
+		}
+	}
+}
+
+void visionDetectionsDraw(Mat &image,
+							const VISION_DETECTIONS *detections,
+							const vector<string> &classes,
+							int labelOffset)
+{
+	for(int i = 0; i < detections->keptCount; i++)
+	{
+		int idx = detections->kept[i];
+		const Rect &box = detections->box[idx];
+		int cls = detections->classId[idx];
+
+		rectangle(image, box, Scalar(0, 255, 0), 1, 8, 0);
+		string label = format("%.2f", detections->confidence[idx]);
+		if (!classes.empty())
+		{
+			CV_Assert(cls < (int)classes.size());
+			label = classes[cls] + ":" + label;
+		}
+		putText(image, label, Point(box.x, box.y + labelOffset), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+	}
+}
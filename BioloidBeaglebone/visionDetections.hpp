@@ -0,0 +1,114 @@
+/** @file visionDetections.hpp
+ *  @brief Function prototypes for decoding and filtering DNN detections.
+ *
+ *  These are the prototypes for functions that: walk the raw output buffers of the
+ *  networks and turn them into boxes, confidences and class ids, and run non maximum
+ *  suppression over the result. All results are written into a VISION_DETECTIONS
+ *  arena that is allocated once and reused for every frame, so decoding a frame does
+ *  not touch the heap. The arena is sized for the handful of boxes we actually see
+ *  from these small networks; anything beyond VISION_DETECTIONS_MAX is counted as
+ *  dropped rather than stored. There is also a function to draw the kept detections.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONDETECTIONS_HPP_
+#define VISIONDETECTIONS_HPP_
+
+#include <vector>
+#include <string>
+#include "opencv2/core.hpp"
+
+#define VISION_DETECTIONS_MAX			256
+
+typedef struct{
+	cv::Rect box[VISION_DETECTIONS_MAX];
+	float confidence[VISION_DETECTIONS_MAX];
+	int classId[VISION_DETECTIONS_MAX];
+	int count;
+	int dropped;
+	int kept[VISION_DETECTIONS_MAX];
+	int keptCount;
+} VISION_DETECTIONS;
+
+/** @brief Empties a detection arena without releasing anything.
+ *
+ *	@param	detections the arena to reset.
+ * 	@return void.
+ *
+ */
+void visionDetectionsClear(VISION_DETECTIONS *detections);
+
+/** @brief Decodes the output layers of a Darknet (YOLO region) network.
+ *
+ * 	Each output row is [centerX, centerY, width, height, objectness, class scores...],
+ * 	with the class scores already multiplied by the objectness. That means no class can
+ * 	score higher than the objectness, so rows whose objectness is below the threshold
+ * 	are rejected before we ever look at the class scores. Surviving rows are reduced
+ * 	with a plain argmax over the float buffer and appended to the arena.
+ *
+ *	@param	outs the output blobs returned by Net::forward.
+ *	@param	confidenceThreshold the minimum class score for a row to be kept.
+ *	@param	imageSize the size of the image the boxes should be scaled to.
+ *	@param	detections the arena to fill. It is cleared first.
+ * 	@return void.
+ *
+ */
+void visionDetectionsDecodeDarknet(const std::vector<cv::Mat> &outs,
+									float confidenceThreshold,
+									cv::Size imageSize,
+									VISION_DETECTIONS *detections);
+
+/** @brief Decodes the DetectionOutput layer of an SSD (Caffe) network.
+ *
+ * 	The output is a 1x1xNx7 blob of [imageId, classId, confidence, left, top, right,
+ * 	bottom] records with the coordinates as fractions of the input. The records are
+ * 	contiguous, so we step through them as a flat float array rather than doing a 4-D
+ * 	index computation for every field. SSD has already done its own suppression, so
+ * 	every decoded detection is also marked as kept.
+ *
+ *	@param	output the blob returned by Net::forward.
+ *	@param	confidenceThreshold the minimum confidence for a record to be kept.
+ *	@param	imageSize the size of the image the boxes should be scaled to.
+ *	@param	detections the arena to fill. It is cleared first.
+ * 	@return void.
+ *
+ */
+void visionDetectionsDecodeSSD(const cv::Mat &output,
+								float confidenceThreshold,
+								cv::Size imageSize,
+								VISION_DETECTIONS *detections);
+
+/** @brief Class aware non maximum suppression over an arena.
+ *
+ * 	Orders the detections by confidence with an insertion sort (we only ever have a few
+ * 	dozen candidates), then greedily keeps the best box and suppresses any lower scoring
+ * 	box of the same class that overlaps it by more than the threshold. The indices of
+ * 	the survivors end up in detections->kept.
+ *
+ *	@param	detections the arena to filter.
+ *	@param	nmsThreshold the intersection over union above which a box is suppressed.
+ * 	@return void.
+ *
+ */
+void visionDetectionsNMS(VISION_DETECTIONS *detections, float nmsThreshold);
+
+/** @brief Draws a box and a 'class:confidence' label for every kept detection.
+ *
+ *	@param	image the image to draw on.
+ *	@param	detections the decoded (and suppressed) detections.
+ *	@param	classes the class names, or empty to label with the confidence only.
+ *	@param	labelOffset how far below the top of the box to put the label.
+ * 	@return void.
+ *
+ */
+void visionDetectionsDraw(cv::Mat &image,
+							const VISION_DETECTIONS *detections,
+							const std::vector<std::string> &classes,
+							int labelOffset);
+
+#endif /* VISIONDETECTIONS_HPP_ */
@@ -0,0 +1,109 @@
+/** @file visionFocus.cpp
+ *  @brief Functions for focusing processing on the last known target.
+ *
+ *  The motion model is just the displacement between the last two finds, in pixels per
+ *  processed frame, which is plenty for sizing a search window.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include "visionFocus.hpp"
+
+using namespace std;
+using namespace cv;
+
+void visionFocusInitialize(VISION_FOCUS *focus, Size frameSize, bool enabled)
+{
+	focus->frameSize = frameSize;
+	focus->enabled = enabled;
+	focus->frames = 0;
+	focus->pixels = 0;
+	visionFocusReset(focus);
+}
+
+void visionFocusReset(VISION_FOCUS *focus)
+{
+	focus->locked = false;
+	focus->target = Rect();
+	focus->velocity = Point(0, 0);
+	focus->misses = 0;
+}
+
+/*
+ * Moves a window of the given size so it is centred on center but inside the frame.
+ */
+static Rect visionFocusPlace(const VISION_FOCUS *focus, Point center, Size size)
+{
+	int x = min(max(center.x - size.width / 2, 0), focus->frameSize.width - size.width);
+	int y = min(max(center.y - size.height / 2, 0), focus->frameSize.height - size.height);
+	return Rect(x, y, size.width, size.height);
+}
+
+Rect visionFocusWindow(VISION_FOCUS *focus, Size fixedSize)
+{
+	Rect window(Point(0, 0), focus->frameSize);
+
+	if(focus->enabled && focus->locked)
+	{
+		Point center(focus->target.x + focus->target.width / 2 + focus->velocity.x,
+						focus->target.y + focus->target.height / 2 + focus->velocity.y);
+		Size needed(max((int)(focus->target.width * (1 + 2 * VISION_FOCUS_MARGIN)) + 2 * abs(focus->velocity.x), VISION_FOCUS_MIN_SIZE),
+					max((int)(focus->target.height * (1 + 2 * VISION_FOCUS_MARGIN)) + 2 * abs(focus->velocity.y), VISION_FOCUS_MIN_SIZE));
+
+		if(fixedSize.area() == 0)
+		{
+			needed.width = min(needed.width, focus->frameSize.width);
+			needed.height = min(needed.height, focus->frameSize.height);
+			window = visionFocusPlace(focus, center, needed);
+		}
+		else if(needed.width <= fixedSize.width && needed.height <= fixedSize.height)
+		{
+			window = visionFocusPlace(focus, center, fixedSize);
+		}
+	}
+
+	focus->frames++;
+	focus->pixels += window.area();
+	return window;
+}
+
+void visionFocusUpdate(VISION_FOCUS *focus, const Rect *target)
+{
+	if(target == NULL)
+	{
+		if(++focus->misses >= VISION_FOCUS_LOST_FRAMES) visionFocusReset(focus);
+		return;
+	}
+
+	if(focus->locked)
+	{
+		focus->velocity = Point((target->x + target->width / 2) - (focus->target.x + focus->target.width / 2),
+								(target->y + target->height / 2) - (focus->target.y + focus->target.height / 2));
+	}
+	focus->target = *target;
+	focus->locked = true;
+	focus->misses = 0;
+}
+
+void visionFocusUpdateDetections(VISION_FOCUS *focus, const VISION_DETECTIONS *detections)
+{
+	int best = -1;
+
+	for(int i = 0; i < detections->keptCount; i++)
+	{
+		int idx = detections->kept[i];
+		if(best < 0 || detections->confidence[idx] > detections->confidence[best]) best = idx;
+	}
+	visionFocusUpdate(focus, (best < 0) ? NULL : &(detections->box[best]));
+}
+
+double visionFocusAveragePixels(const VISION_FOCUS *focus)
+{
+	return (focus->frames > 0) ? (double)focus->pixels / focus->frames : 0;
+}
@@ -0,0 +1,101 @@
+/** @file visionFocus.hpp
+ *  @brief Function prototypes for focusing processing on the last known target.
+ *
+ *  These are the prototypes for functions that: remember where the target was last
+ *  found and how far it moved between the last two finds, work out a search window
+ *  around where it should be next, and widen back out to the whole frame once the
+ *  target has been missed a few frames running. The vision modes then only process
+ *  the pixels in the window. The number of pixels processed is counted so the saving
+ *  can be reported.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONFOCUS_HPP_
+#define VISIONFOCUS_HPP_
+
+#include <stdint.h>
+#include "opencv2/core.hpp"
+#include "visionDetections.hpp"
+
+#define VISION_FOCUS_MARGIN				1.0f
+#define VISION_FOCUS_MIN_SIZE			48
+#define VISION_FOCUS_LOST_FRAMES		3
+
+typedef struct{
+	cv::Size frameSize;
+	bool enabled;
+	bool locked;
+	cv::Rect target;
+	cv::Point velocity;
+	int misses;
+	uint64_t frames;
+	uint64_t pixels;
+} VISION_FOCUS;
+
+/** @brief Sets up focusing for frames of a given size
+ *
+ *	@param	focus the focus state to initialize.
+ *	@param	frameSize the size of the frames.
+ *	@param	enabled false to always use the whole frame (pixels are still counted).
+ * 	@return void.
+ *
+ */
+void visionFocusInitialize(VISION_FOCUS *focus, cv::Size frameSize, bool enabled);
+
+/** @brief Forgets the target, so the next window is the whole frame
+ *
+ *	@param	focus the focus state.
+ * 	@return void.
+ *
+ */
+void visionFocusReset(VISION_FOCUS *focus);
+
+/** @brief Works out the region of the frame to process next
+ *
+ * 	The window is centred where the target should be if it keeps moving as it did
+ * 	between the last two finds. With no fixed size, it is the target's box grown by
+ * 	VISION_FOCUS_MARGIN of its size on every side plus the distance it is expected to
+ * 	move. With a fixed size (the networks, which need the same input size every frame)
+ * 	it is that size, unless the grown box wouldn't fit in it. Either way it is kept
+ * 	inside the frame, and it is the whole frame when there is no target or it won't fit.
+ * 	The window's area is added to the pixel count.
+ *
+ *	@param	focus the focus state.
+ *	@param	fixedSize the size the window must be, or an empty size for any size.
+ * 	@return the window, in frame coordinates.
+ *
+ */
+cv::Rect visionFocusWindow(VISION_FOCUS *focus, cv::Size fixedSize);
+
+/** @brief Records where the target was found this frame, if it was
+ *
+ *	@param	focus the focus state.
+ *	@param	target the target's box in frame coordinates, or NULL if it wasn't found.
+ * 	@return void.
+ *
+ */
+void visionFocusUpdate(VISION_FOCUS *focus, const cv::Rect *target);
+
+/** @brief Records the most confident kept detection as the target
+ *
+ *	@param	focus the focus state.
+ *	@param	detections the frame's detections, boxes in frame coordinates.
+ * 	@return void.
+ *
+ */
+void visionFocusUpdateDetections(VISION_FOCUS *focus, const VISION_DETECTIONS *detections);
+
+/** @brief Gets the average number of pixels processed per frame
+ *
+ *	@param	focus the focus state.
+ * 	@return the average window area, or 0 if no frames have been processed.
+ *
+ */
+double visionFocusAveragePixels(const VISION_FOCUS *focus);
+
+#endif /* VISIONFOCUS_HPP_ */
@@ -11,7 +11,9 @@
  *  cvInRangeS function to mask a certain color (aibo ball pink) and cvMoments to identify
  *  instances of it in the image. The initialize function creates two windows, one for the
  *  image and one for the thresholded mask. The main loop updates these windows when the image
- *  ready flag is set.
+ *  ready flag is set. Each frame is copied out of the PRU carveout into a buffer from
+ *  the frame pool as soon as it is ready and the PRU is released straight away, so the
+ *  PRU never writes under a frame we are processing or drawing on.
  *
  *  @author Bill Merryman
  *  @bug No known bugs.
@@ -22,12 +24,31 @@
 
 #include <iostream>
 #include <fstream>
+#include <unistd.h>
+#include <math.h>
+#include <malloc.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <thread>
+#include <atomic>
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/opencv.hpp"
 #include "opencv2/dnn.hpp"
 #include "opencv2/dnn/shape_utils.hpp"
 #include "visionManager.hpp"
+#include "visionDetections.hpp"
+#include "visionPreprocess.hpp"
+#include "visionAutotune.hpp"
+#include "frameRecording.hpp"
+#include "framePublisher.hpp"
+#include "framePool.hpp"
+#include "visionMotion.hpp"
+#include "visionFocus.hpp"
+#include "visionTracker.hpp"
+#include "visionScheduler.hpp"
+#include "visionPyramid.hpp"
 
 extern "C"
 {
@@ -39,9 +60,126 @@ using namespace std;
 using namespace cv;
 using namespace cv::dnn;
 
+/*
+ * PRU1 stores the frame the way round visionManagerSetCaptureOrientation asks, so any
+ * fixed correction belongs there and costs nothing. The networks see the frame
+ * through the preprocessing plans below, which can also reorient it for free as they
+ * read it, should they alone need it some other way. Set that correction here.
+ */
+#define NETWORK_INPUT_ORIENTATION		VISION_PREPROCESS_KEEP
+
+/*
+ * In focus mode the networks look at a window this many times smaller than the frame
+ * (each way), through a network input the same number of times smaller, so the pixel
+ * density the network sees is unchanged and the forward pass gets cheaper. Darknet
+ * input sizes have to be multiples of 32.
+ */
+#define FOCUS_WINDOW_DIVISOR			2
+#define DARKNET_INPUT_ALIGNMENT			32
+
+/*
+ * Thresholding, and the display when there is a window to show it in, work on the
+ * largest pyramid level no bigger than this; the networks read the frame itself, so
+ * at VGA they keep the detail for distant objects.
+ */
+#define THRESHOLD_MAX_COLUMNS			IMAGE_COLUMNS_IN_PIXELS_QVGA
+#define THRESHOLD_MAX_ROWS				IMAGE_ROWS_IN_PIXELS_QVGA
+
+/*
+ * The window of the sensor's frame PRU1 captures, and how much it decimates it,
+ * asked for in frame coordinates (the view we get, in the capture orientation) and
+ * handed to PRU1 in its scan order. Frames captured before PRU1 picks up the
+ * configuration are dropped.
+ */
+Rect captureWindow;
+int captureDecimation = 1;
+int captureFormat = CAPTURE_FORMAT_RGB;
+int captureOrientation = CAPTURE_ORIENTATION_ROTATED;
+CAPTURE_CONFIGURATION captureConfiguration;
+volatile CAPTURE_CONFIGURATION *frameConfiguration;
+
+/*
+ * The resolution the PRU1 firmware was built for, as it reports it, and the pyramid
+ * of the current frame with the level thresholding and the display use.
+ */
+Size sensorSize;
+VISION_PYRAMID pyramid;
+int thresholdLevel = 0;
+
+/*
+ * Whether PRU1 draws its test pattern instead of capturing, and how often.
+ */
+bool testPattern = false;
+int testPatternRate = 0;
+
+/*
+ * PRU1's capture governor: the settings asked for, and whether the scheduled mode may
+ * stretch the interval to match what it consumes.
+ */
+int captureEvery = 1;
+int captureIntervalMilliseconds = 0;
+bool captureGoverned = false;
+volatile CAPTURE_GOVERNOR *captureGovernor;
+
+/*
+ * With PRU segmentation on, PRU1 thresholds RGB frames against the current threshold
+ * box as it captures them. The threshold mode uses its moments instead of going over
+ * the frame, and when nothing needs the frame itself (headless, not recording or
+ * publishing) it isn't even copied out of the carveout.
+ */
+bool pruSegmentation = false;
+volatile SEGMENTATION_CONFIGURATION *segmentationConfiguration;
+volatile SEGMENTATION_RESULT *segmentationResult;
+SEGMENTATION_RESULT frameSegmentation;
+bool frameSegmented = false;
+
 volatile int *imageReadyFlag;
+volatile CAPTURE_STATISTICS *captureStatistics;
+
+/*
+ * Where a frame is released back to PRU1, in the PRU subsystem's shared RAM; NULL
+ * when a stand-in takes PRU1's place, which goes by the image ready flag alone.
+ */
+volatile PRU_INTEROP_1_HANDSHAKE *handshake;
+
+/*
+ * PRU1's view of the camera timing. Frames it abandons never reach us, so a change in
+ * its abandoned count is reported when the next good frame arrives.
+ */
+volatile CAPTURE_HEALTH *captureHealth;
+uint32_t reportedAbandonedFrames = 0;
+
+cv::Mat captureImage;
 cv::Mat displayImage;
 cv::Mat processingImage;
+cv::Mat networkImage;
+FRAME_POOL_FRAME *currentFrame = NULL;
+
+/*
+ * The networks only run on frames where the scene has changed (or at least every
+ * motionGateMaxSkip frames); otherwise the last detections are reused.
+ */
+VISION_MOTION motionGate;
+int motionGateThreshold = 0;
+int motionGateMaxSkip = VISION_MOTION_DEFAULT_MAX_SKIP;
+
+VISION_FOCUS focus;
+bool focusEnabled = false;
+
+/*
+ * Every target the modes find is tracked, so the one worth following can be predicted
+ * to where it will be by the time anything acts on it.
+ */
+VISION_TRACKER tracker;
+int predictionLatencyMilliseconds = VISION_PREDICTION_DEFAULT_LATENCY_MS;
+
+/*
+ * Every task's run time is measured whichever mode ran it, so the scheduled mode knows
+ * the costs from the start. frameTasks collects what ran on the current frame.
+ */
+VISION_SCHEDULER scheduler;
+float schedulerBudgetMilliseconds = VISION_SCHEDULER_DEFAULT_BUDGET_MS;
+uint32_t frameTasks = 0;
 
 Net caffeNet;
 Net darknetNet;
@@ -51,6 +189,8 @@ int imageProcessingType = 0;
 Scalar thresholdLow = Scalar(60, 0, 100);
 Scalar thresholdHigh = Scalar(200, 80, 255);
 Rect thresholdROI = Rect(135, 95, 50, 50);
+double thresholdArea = 0;
+Point thresholdPosition;
 
 float caffeConfidence = 0.0;
 float darknetConfidence = 0.0;
@@ -60,8 +200,595 @@ std::vector<std::string> caffeClasses;
 std::vector<std::string> darknetClasses;
 
 std::vector<cv::String> unconnectedOutputLayersNames;
+std::vector<cv::Mat> darknetOutputs;
+VISION_DETECTIONS darknetDetections;
+VISION_DETECTIONS caffeDetections;
+VISION_PREPROCESS caffePreprocess;
+VISION_PREPROCESS darknetPreprocess;
+VISION_PREPROCESS caffeFocusPreprocess;
+VISION_PREPROCESS darknetFocusPreprocess;
+
+VISION_NETWORK_CONFIG caffeNetworkConfig = {DNN_BACKEND_DEFAULT, DNN_TARGET_CPU, Size(320, 240)};
+VISION_NETWORK_CONFIG darknetNetworkConfig = {DNN_BACKEND_DEFAULT, DNN_TARGET_CPU, Size(192, 192)};
+
+/*
+ * The networks are only loaded the first time their mode is selected, and can be
+ * loaded on a background thread so the display keeps running meanwhile. state is
+ * the only thing the main loop looks at while a load is in progress; the loader
+ * thread owns everything else in the model until it sets state to MODEL_LOADED.
+ */
+typedef enum{
+	MODEL_UNLOADED,
+	MODEL_LOADING,
+	MODEL_LOADED
+} MODEL_STATE;
+
+typedef struct{
+	const char *name;
+	string modelFile;
+	string configFile;
+	Net *net;
+	VISION_NETWORK_CONFIG *config;
+	void (*initialize)();
+	std::thread loader;
+	std::atomic<int> state;
+	long residentBytes;
+} VISION_MODEL;
+
+VISION_MODEL caffeModel;
+VISION_MODEL darknetModel;
+
+bool backgroundModelLoading = false;
+long modelMemoryBudget = 0;
+bool firstFrameReported = false;
+
+const char *recordingFile = NULL;
+const char *publishingName = NULL;
+uint64_t frameTimestamp = 0;
+
+/*
+ * Headless runs never open a window and skip all drawing, except for the one frame
+ * after a dump has been requested, which is drawn as usual and written to a file.
+ */
+bool headless = false;
+bool dumpRequested = false;
+const char *dumpPrefix = VISION_DUMP_DEFAULT_PREFIX;
+int dumpCount = 0;
+
+static double visionManagerSecondsSinceStart()
+{
+	unsigned long long startTicks = 0;
+	struct timespec now;
+	char stat[1024];
+
+	FILE *file = fopen("/proc/self/stat", "r");
+	if(!file) return 0;
+	size_t length = fread(stat, 1, sizeof(stat) - 1, file);
+	fclose(file);
+	stat[length] = '\0';
+
+	/* Field 22 (starttime) counts from the closing paren of the command name. */
+	char *field = strrchr(stat, ')');
+	for(int counter = 0; field != NULL && counter < 20; counter++) field = strchr(field + 1, ' ');
+	if(field == NULL || sscanf(field + 1, "%llu", &startTicks) != 1) return 0;
+
+	clock_gettime(CLOCK_BOOTTIME, &now);
+	return (now.tv_sec + now.tv_nsec / 1e9) - ((double)startTicks / sysconf(_SC_CLK_TCK));
+}
+
+static long visionManagerResidentBytes()
+{
+	long size = 0;
+	long resident = 0;
+
+	FILE *file = fopen("/proc/self/statm", "r");
+	if(!file) return 0;
+	if(fscanf(file, "%ld %ld", &size, &resident) != 2) resident = 0;
+	fclose(file);
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+static long visionManagerEstimatedModelBytes(VISION_MODEL *model)
+{
+	struct stat fileStatus;
+
+	if(model->residentBytes > 0) return model->residentBytes;
+	if(stat(model->modelFile.c_str(), &fileStatus) != 0) return 0;
+	return fileStatus.st_size;
+}
+
+static void visionManagerLoadModel(VISION_MODEL *model)
+{
+	int64 start = getTickCount();
+	long residentBefore = visionManagerResidentBytes();
+
+	*(model->net) = cv::dnn::readNet(model->modelFile, model->configFile);
+	model->net->setPreferableBackend(model->config->backend);
+	model->net->setPreferableTarget(model->config->target);
+	model->initialize();
+
+	/*
+	 * The first forward pass is where OpenCV allocates its buffers and picks its
+	 * kernels, so do it here rather than on the first real frame.
+	 */
+	Mat blank = Mat::zeros(captureImage.size(), CV_8UC3);
+	if(model == &caffeModel)
+	{
+		caffeNet.setInput(visionPreprocessRun(&caffePreprocess, blank));
+		caffeNet.forward();
+	}
+	else
+	{
+		darknetNet.setInput(visionPreprocessRun(&darknetPreprocess, blank));
+		darknetNet.forward(darknetOutputs, unconnectedOutputLayersNames);
+	}
+
+	long residentAfter = visionManagerResidentBytes();
+	model->residentBytes = max(residentAfter - residentBefore, 0L);
+	printf("%s model loaded in %.0f ms, +%ld KB, resident %ld KB\n",
+			model->name,
+			(getTickCount() - start) * 1000.0 / getTickFrequency(),
+			model->residentBytes / 1024,
+			residentAfter / 1024);
+
+	model->state = MODEL_LOADED;
+}
+
+static void visionManagerUnloadModel(VISION_MODEL *model)
+{
+	if(model->loader.joinable()) model->loader.join();
+	if(model->state == MODEL_UNLOADED) return;
+
+	*(model->net) = Net();
+	model->state = MODEL_UNLOADED;
+	malloc_trim(0);
+	printf("%s model unloaded, resident %ld KB\n", model->name, visionManagerResidentBytes() / 1024);
+}
+
+/*
+ * Returns true when the model is ready to run. Otherwise starts loading it (after
+ * making room for it under the memory budget) if that hasn't been done yet.
+ */
+static bool visionManagerRequireModel(VISION_MODEL *model)
+{
+	if(model->state == MODEL_LOADED)
+	{
+		if(model->loader.joinable()) model->loader.join();
+		return true;
+	}
+	if(model->state == MODEL_LOADING) return false;
+
+	VISION_MODEL *idle = (model == &caffeModel) ? &darknetModel : &caffeModel;
+	if(modelMemoryBudget > 0 && idle->state != MODEL_UNLOADED &&
+		idle->residentBytes + visionManagerEstimatedModelBytes(model) > modelMemoryBudget)
+	{
+		visionManagerUnloadModel(idle);
+	}
+
+	if(backgroundModelLoading)
+	{
+		model->state = MODEL_LOADING;
+		model->loader = std::thread(visionManagerLoadModel, model);
+		return false;
+	}
+
+	visionManagerLoadModel(model);
+	return true;
+}
+
+static float visionManagerMillisecondsSince(int64 start)
+{
+	return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+static void visionManagerRecordTask(VISION_TASK task, int64 start)
+{
+	visionSchedulerRecord(&scheduler, task, visionManagerMillisecondsSince(start));
+	frameTasks |= VISION_TASK_BIT(task);
+}
+
+static bool visionManagerDrawing()
+{
+	return !headless || dumpRequested;
+}
+
+static void visionManagerSetTitles(const char *displayTitle, const char *processingTitle)
+{
+	if(headless) return;
+	setWindowTitle("Display_Image", displayTitle);
+	setWindowTitle("Processing_Image", processingTitle);
+}
+
+static void visionManagerShow(const Mat &display, const Mat &processing)
+{
+	if(!headless)
+	{
+		/* the drawing is on the frame itself, so a large one is reduced as it is shown */
+		static Mat shown;
+		if(display.size() != processing.size() && display.size() == pyramid.frameSize)
+		{
+			resize(display, shown, processing.size(), 0, 0, INTER_AREA);
+			imshow("Display_Image", shown);
+		}
+		else imshow("Display_Image", display);
+		imshow("Processing_Image", processing);
+		return;
+	}
+	if(!dumpRequested) return;
+
+	dumpRequested = false;
+	string filename = format("%s%04d.png", dumpPrefix, dumpCount++);
+	if(imwrite(filename, display)) printf("Wrote %s\n", filename.c_str());
+	else fprintf(stderr, "Could not write %s\n", filename.c_str());
+}
+
+static void visionManagerDrawFocus(const Rect &window)
+{
+	if(window.size() != displayImage.size()) rectangle(displayImage, window, Scalar(255, 0, 0), 1, 8, 0);
+}
+
+static void visionManagerDrawPrediction()
+{
+	float x;
+	float y;
+
+	if(visionManagerPredictTarget(&x, &y)) circle(displayImage, Point(x, y), 4, Scalar(0, 0, 255), 2, 8, 0);
+}
+
+void visionManagerSetPredictionLatency(int milliseconds)
+{
+	predictionLatencyMilliseconds = milliseconds;
+}
+
+int visionManagerPredictTarget(float *x, float *y)
+{
+	int primary = visionTrackerPrimary(&tracker);
+	if(primary < 0) return 0;
+
+	Point2f predicted = visionTrackerPredict(&tracker, primary, frameRecordingNow() + predictionLatencyMilliseconds * 1000000ull);
+	*x = predicted.x;
+	*y = predicted.y;
+	return 1;
+}
 
-void visionManagerInitialize(const char *caffeNamesFile,
+/*
+ * Stored pixel i of a window line is sensor pixel firstColumn + i x decimation if the
+ * columns are stored forwards, and firstColumn + (n - 1 - i) x decimation of the n
+ * stored if backwards, which is sensor width - 1 minus that in full frame pixels the
+ * same way round; rows likewise.
+ */
+static Point2f visionManagerToFullFrame(Point2f point)
+{
+	const int decimation = captureConfiguration.decimation;
+	const int firstColumn = captureConfiguration.firstColumn;
+	const int firstRow = captureConfiguration.firstRow;
+	const int columnOrigin = CAPTURE_COLUMNS_FORWARD(captureConfiguration.orientation) ? firstColumn :
+								sensorSize.width - firstColumn - (int)captureConfiguration.columns + decimation - 1;
+	const int rowOrigin = CAPTURE_ROWS_FORWARD(captureConfiguration.orientation) ? firstRow :
+								sensorSize.height - firstRow - (int)captureConfiguration.rows + decimation - 1;
+
+	return Point2f(columnOrigin + point.x * decimation, rowOrigin + point.y * decimation);
+}
+
+int visionManagerMeasuredTarget(float *x, float *y, uint64_t *measured)
+{
+	int primary = visionTrackerPrimary(&tracker);
+	if(primary < 0) return 0;
+
+	Point2f center = visionManagerToFullFrame(tracker.targets[primary].measured);
+	*x = center.x;
+	*y = center.y;
+	*measured = tracker.targets[primary].lastSeen;
+	return 1;
+}
+
+void visionManagerSetFrameBudget(int milliseconds)
+{
+	schedulerBudgetMilliseconds = milliseconds;
+}
+
+void visionManagerSetControlDemand(int demand)
+{
+	scheduler.controlDemand = demand;
+}
+
+void visionManagerSetMotionGate(int threshold, int maxSkip)
+{
+	motionGateThreshold = (threshold < 0) ? VISION_MOTION_DEFAULT_THRESHOLD : threshold;
+	if(maxSkip > 0) motionGateMaxSkip = maxSkip;
+}
+
+void visionManagerSetFocus(int enable)
+{
+	focusEnabled = enable;
+}
+
+void visionManagerSetCaptureWindow(int x, int y, int width, int height, int decimation)
+{
+	captureWindow = Rect(x, y, width, height);
+	captureDecimation = decimation;
+}
+
+void visionManagerSetCaptureFormat(int format)
+{
+	captureFormat = format;
+}
+
+void visionManagerSetCaptureOrientation(int orientation)
+{
+	captureOrientation = orientation;
+}
+
+void visionManagerSetPRUSegmentation(int enable)
+{
+	pruSegmentation = enable;
+}
+
+void visionManagerSetTestPattern(int enable, int framesPerSecond)
+{
+	testPattern = enable;
+	testPatternRate = max(framesPerSecond, 0);
+}
+
+void visionManagerSetCaptureGovernor(int every, int intervalMilliseconds, int governed)
+{
+	captureEvery = max(every, 1);
+	captureIntervalMilliseconds = max(intervalMilliseconds, 0);
+	captureGoverned = governed;
+}
+
+/*
+ * Asks PRU1 for frames no more often than the settings allow, nor than every
+ * intervalMilliseconds; written only when it moves to another whole millisecond, so
+ * the carveout isn't written every frame for nothing.
+ */
+static void visionManagerGovernCapture(float intervalMilliseconds)
+{
+	const uint32_t microseconds = min((uint32_t)(max((float)captureIntervalMilliseconds, intervalMilliseconds) * 1000),
+										(uint32_t)CAPTURE_GOVERNOR_MAX_MICROSECONDS);
+
+	if(microseconds / 1000 == captureGovernor->frameIntervalMicroseconds / 1000) return;
+	captureGovernor->frameIntervalMicroseconds = microseconds;
+}
+
+void visionManagerGetSensorSize(int *width, int *height)
+{
+	*width = sensorSize.width;
+	*height = sensorSize.height;
+}
+
+/*
+ * Rounds the requested window to what PRU1 can capture (see CAPTURE_CONFIGURATION):
+ * the width down to a multiple of CAPTURE_COLUMN_ALIGNMENT decimated pixels, the
+ * height down to a multiple of the decimation, and the first sensor column down to a
+ * multiple of CAPTURE_COLUMN_ALIGNMENT, which moves the window toward the sensor's
+ * first column (right in our view if the columns are stored backwards).
+ */
+static void visionManagerConfigureCapture()
+{
+	const int frameColumns = sensorSize.width;
+	const int frameRows = sensorSize.height;
+	int decimation = (captureDecimation == 2 || captureDecimation == 4) ? captureDecimation : 1;
+	Rect window = captureWindow & Rect(0, 0, frameColumns, frameRows);
+	if(window.area() == 0) window = Rect(0, 0, frameColumns, frameRows);
+
+	int columns = max(window.width / (CAPTURE_COLUMN_ALIGNMENT * decimation), 1) * CAPTURE_COLUMN_ALIGNMENT * decimation;
+	int rows = max(window.height / decimation, 1) * decimation;
+	int orientation = captureOrientation & CAPTURE_ORIENTATION_NORMAL;
+	int firstColumn = CAPTURE_COLUMNS_FORWARD(orientation) ? window.x : max(frameColumns - (window.x + columns), 0);
+	int firstRow = CAPTURE_ROWS_FORWARD(orientation) ? window.y : max(frameRows - (window.y + rows), 0);
+	firstColumn &= ~(CAPTURE_COLUMN_ALIGNMENT - 1);
+
+	captureConfiguration.firstColumn = firstColumn;
+	captureConfiguration.firstRow = firstRow;
+	captureConfiguration.columns = columns;
+	captureConfiguration.rows = rows;
+	captureConfiguration.decimation = decimation;
+	captureConfiguration.format = (captureFormat == CAPTURE_FORMAT_UYVY || captureFormat == CAPTURE_FORMAT_Y8) ? captureFormat : CAPTURE_FORMAT_RGB;
+	captureConfiguration.orientation = orientation;
+}
+
+/*
+ * PRU1 writes its resolution as it starts; the carveout is zeroed when it is allocated,
+ * so until then it reads zero. Anything but QVGA or VGA after the wait is taken to be
+ * QVGA, the resolution the firmware was always built for before.
+ */
+static void visionManagerReadSensor(volatile CAPTURE_SENSOR *sensor)
+{
+	for(int waited = 0; sensor->columns == 0 && waited * VISION_FRAME_POLL_MICROSECONDS < VISION_SENSOR_TIMEOUT_MS * 1000; waited++)
+	{
+		usleep(VISION_FRAME_POLL_MICROSECONDS);
+	}
+
+	sensorSize = Size(sensor->columns, sensor->rows);
+	if(sensorSize != Size(IMAGE_COLUMNS_IN_PIXELS_QVGA, IMAGE_ROWS_IN_PIXELS_QVGA) &&
+		sensorSize != Size(IMAGE_COLUMNS_IN_PIXELS_VGA, IMAGE_ROWS_IN_PIXELS_VGA))
+	{
+		fprintf(stderr, "PRU1 reported a %dx%d sensor; assuming QVGA\n", sensorSize.width, sensorSize.height);
+		sensorSize = Size(IMAGE_COLUMNS_IN_PIXELS_QVGA, IMAGE_ROWS_IN_PIXELS_QVGA);
+	}
+}
+
+/*
+ * The carveout holds the capture as PRU1 stored it: BGR, UYVY (YVYU if the columns
+ * are stored backwards) or luma. Frames are processed as BGR, except Y8 ones, which stay single
+ * channel unless color is asked for, so the luma-only work never touches three
+ * channels.
+ */
+static int visionManagerCaptureType()
+{
+	if(captureConfiguration.format == CAPTURE_FORMAT_UYVY) return CV_8UC2;
+	if(captureConfiguration.format == CAPTURE_FORMAT_Y8) return CV_8UC1;
+	return CV_8UC3;
+}
+
+static void visionManagerCopyCapture(Mat &destination, bool color)
+{
+	if(captureConfiguration.format == CAPTURE_FORMAT_UYVY)
+	{
+		cvtColor(captureImage, destination, CAPTURE_COLUMNS_FORWARD(captureConfiguration.orientation) ? COLOR_YUV2BGR_UYVY : COLOR_YUV2BGR_YVYU);
+	}
+	else if(captureConfiguration.format == CAPTURE_FORMAT_Y8 && color) cvtColor(captureImage, destination, COLOR_GRAY2BGR);
+	else captureImage.copyTo(destination);
+}
+
+/*
+ * PRU1 segments RGB captures, but at VGA only decimated ones (see
+ * IMAGE_SEGMENT_FULL_RESOLUTION in image.h); anything else is thresholded here.
+ */
+static bool visionManagerPRUCanSegment()
+{
+	return captureConfiguration.format == CAPTURE_FORMAT_RGB &&
+			(sensorSize.width == IMAGE_COLUMNS_IN_PIXELS_QVGA || captureConfiguration.decimation != 1);
+}
+
+/*
+ * The box goes to PRU1 every frame, so a newly captured threshold applies from the
+ * next frame on.
+ */
+static void visionManagerWriteSegmentationBox()
+{
+	for(int channel = 0; channel < 3; channel++)
+	{
+		segmentationConfiguration->low[channel] = saturate_cast<uint8_t>(thresholdLow[channel]);
+		segmentationConfiguration->high[channel] = saturate_cast<uint8_t>(thresholdHigh[channel]);
+	}
+	segmentationConfiguration->enabled = pruSegmentation && visionManagerPRUCanSegment();
+}
+
+/*
+ * Takes a copy of the segmentation for the frame in the carveout (it is overwritten
+ * with the next), if PRU1 segmented that frame.
+ */
+static void visionManagerReadSegmentation()
+{
+	frameSegmented = segmentationConfiguration->enabled &&
+						segmentationResult->frame != 0 &&
+						segmentationResult->frame == captureStatistics->frames;
+	if(!frameSegmented) return;
+
+	frameSegmentation.m00 = segmentationResult->m00;
+	frameSegmentation.m10 = segmentationResult->m10;
+	frameSegmentation.m01 = segmentationResult->m01;
+	frameSegmentation.runCount = min((uint32_t)segmentationResult->runCount, (uint32_t)SEGMENTATION_MAX_RUNS);
+	frameSegmentation.runsDropped = segmentationResult->runsDropped;
+	memcpy(frameSegmentation.runs, (const void *)segmentationResult->runs, frameSegmentation.runCount * sizeof(SEGMENTATION_RUN));
+}
+
+/*
+ * The networks want BGR; a Y8 frame is expanded just for them.
+ */
+static const Mat &visionManagerNetworkView(const Mat &view)
+{
+	if(view.channels() == 3) return view;
+	cvtColor(view, networkImage, COLOR_GRAY2BGR);
+	return networkImage;
+}
+
+static void visionManagerReportCaptureHealth(FILE *stream)
+{
+	const float cyclesPerMicrosecond = 200.0f;
+
+	fprintf(stream, "PRU1 capture health: %u timeouts, %u frames abandoned, %u torn, %u short lines\n",
+			captureHealth->timeouts,
+			captureHealth->abandonedFrames,
+			captureHealth->tornFrames,
+			captureHealth->shortLines);
+	if(captureHealth->pclkCycles == 0 || captureHealth->lines == 0) return;
+	const float pclkCycles = (float)captureHealth->pclkCycles / captureHealth->pclkEdges;
+	fprintf(stream, "PRU1 last frame: %u lines, line period %.1f-%.1f us, %.0f-%.0f pixels per line, PCLK %.2f MHz, %.2f ms since the previous VSYNC\n",
+			captureHealth->lines,
+			captureHealth->lineCyclesMinimum / cyclesPerMicrosecond,
+			captureHealth->lineCyclesMaximum / cyclesPerMicrosecond,
+			captureHealth->lineHighMinimum / (2 * pclkCycles),
+			captureHealth->lineHighMaximum / (2 * pclkCycles),
+			cyclesPerMicrosecond / pclkCycles,
+			captureHealth->vsyncCycles / (cyclesPerMicrosecond * 1000));
+}
+
+static void visionManagerCheckCaptureHealth()
+{
+	if(captureHealth->abandonedFrames == reportedAbandonedFrames) return;
+	reportedAbandonedFrames = captureHealth->abandonedFrames;
+	visionManagerReportCaptureHealth(stderr);
+}
+
+static bool visionManagerFrameConfigured()
+{
+	return frameConfiguration->firstColumn == captureConfiguration.firstColumn &&
+			frameConfiguration->firstRow == captureConfiguration.firstRow &&
+			frameConfiguration->columns == captureConfiguration.columns &&
+			frameConfiguration->rows == captureConfiguration.rows &&
+			frameConfiguration->decimation == captureConfiguration.decimation &&
+			frameConfiguration->format == captureConfiguration.format &&
+			frameConfiguration->orientation == captureConfiguration.orientation;
+}
+
+/*
+ * Hands the carveout back to PRU1: the ready flag is cleared before frameTaken is
+ * set, so PRU1 can't hand the next frame over before the flag is down.
+ */
+static void visionManagerReleaseFrame()
+{
+	*imageReadyFlag = IMAGE_NOT_READY;
+	if(handshake == NULL) return;
+	__sync_synchronize();
+	handshake->frameTaken = 1;
+}
+
+/*
+ * Each pass of PRU1's old polling loop was one read of the carveout flag, so the time
+ * it spent waiting on us over the time one such read takes is how many DDR reads the
+ * shared RAM handshake kept off the interconnect.
+ */
+static void visionManagerReportHandshake()
+{
+	const float cyclesPerMicrosecond = 200.0f;
+
+	if(handshake == NULL || handshake->waits == 0) return;
+	printf("PRU1 waited on the shared RAM handshake for %u frames, %.2f ms a frame on average\n",
+			handshake->waits,
+			handshake->waitCycles / (cyclesPerMicrosecond * 1000 * handshake->waits));
+	if(handshake->carveoutReadCycles == 0) return;
+	printf("Polling the carveout instead (%u cycles a read) would have been %.0f DDR reads a frame, %.1f million a second while waiting\n",
+			handshake->carveoutReadCycles,
+			(double)handshake->waitCycles / handshake->carveoutReadCycles / handshake->waits,
+			cyclesPerMicrosecond / handshake->carveoutReadCycles);
+}
+
+void visionManagerSetHeadless(int enable, const char *prefix)
+{
+	headless = enable;
+	if(prefix != NULL) dumpPrefix = prefix;
+}
+
+int visionManagerWaitForFrame(int timeoutMilliseconds)
+{
+	for(int waited = 0; *imageReadyFlag == IMAGE_NOT_READY; waited++)
+	{
+		if(waited * VISION_FRAME_POLL_MICROSECONDS >= timeoutMilliseconds * 1000) return 0;
+		usleep(VISION_FRAME_POLL_MICROSECONDS);
+	}
+	return 1;
+}
+
+void visionManagerSetRecording(const char *filename)
+{
+	recordingFile = filename;
+}
+
+void visionManagerSetPublishing(const char *name)
+{
+	publishingName = (name != NULL) ? name : FRAME_PUBLISHER_DEFAULT_NAME;
+}
+
+void visionManagerSetModelLoading(int background, long memoryBudgetMegabytes)
+{
+	backgroundModelLoading = background;
+	modelMemoryBudget = memoryBudgetMegabytes * 1024 * 1024;
+}
+
+int visionManagerInitialize(const char *caffeNamesFile,
 								const char *prototxtFile,
 								const char *caffemodelFile,
 								float caffeConf,
@@ -71,26 +798,111 @@ void visionManagerInitialize(const char *caffeNamesFile,
 								float darknetConf,
 								float darknetNMSThreshold)
 {
-	CvSize inputSize;
-	inputSize.width = IMAGE_COLUMNS_IN_PIXELS;
-	inputSize.height = IMAGE_ROWS_IN_PIXELS;
-
 	PRU_INTEROP_1_DATA* PRUInterop1Data = getPRUInterop1Data();
 
-	displayImage = cv::Mat(inputSize, CV_8UC3, (void*)(PRUInterop1Data->imageData));
-	processingImage = cv::Mat(inputSize, CV_8UC3);
+	visionManagerReadSensor(&(PRUInterop1Data->captureSensor));
+	visionManagerConfigureCapture();
+	if(recordingFile != NULL &&
+		(captureConfiguration.decimation != 1 ||
+		captureConfiguration.columns != (uint32_t)sensorSize.width ||
+		captureConfiguration.rows != (uint32_t)sensorSize.height ||
+		captureConfiguration.format == CAPTURE_FORMAT_Y8))
+	{
+		fprintf(stderr, "--record stores whole %dx%d frames for --replay; it can't be used with a capture window, decimation or the y8 format\n",
+				sensorSize.width,
+				sensorSize.height);
+		return -1;
+	}
+	PRUInterop1Data->captureConfiguration = captureConfiguration;
+	frameConfiguration = &(PRUInterop1Data->frameConfiguration);
+	PRUInterop1Data->testPatternConfiguration.periodMicroseconds = (testPatternRate > 0) ? 1000000 / testPatternRate : 0;
+	PRUInterop1Data->testPatternConfiguration.enabled = testPattern;
+	captureGovernor = &(PRUInterop1Data->captureGovernor);
+	captureGovernor->vsyncInterval = captureEvery;
+	captureGovernor->frameIntervalMicroseconds = 0;
+	visionManagerGovernCapture(0);
+	if(testPattern) printf("PRU1 is drawing its test pattern instead of capturing\n");
+
+	CvSize inputSize;
+	inputSize.width = captureConfiguration.columns / captureConfiguration.decimation;
+	inputSize.height = captureConfiguration.rows / captureConfiguration.decimation;
+	thresholdROI = Rect((inputSize.width - thresholdROI.width) / 2,
+						(inputSize.height - thresholdROI.height) / 2,
+						thresholdROI.width,
+						thresholdROI.height) & Rect(0, 0, inputSize.width, inputSize.height);
+
+	const int displayType = (captureConfiguration.format == CAPTURE_FORMAT_Y8) ? CV_8UC1 : CV_8UC3;
+	captureImage = cv::Mat(inputSize, visionManagerCaptureType(), (void*)(PRUInterop1Data->imageData));
+	displayImage = cv::Mat::zeros(inputSize, displayType);
+	visionPyramidInitialize(&pyramid, inputSize, displayType);
+	visionPyramidSetFrame(&pyramid, displayImage);
+	thresholdLevel = visionPyramidLevelFor(&pyramid, Size(THRESHOLD_MAX_COLUMNS, THRESHOLD_MAX_ROWS));
+	processingImage = cv::Mat::zeros(visionPyramidLevel(&pyramid, thresholdLevel).size(), CV_8UC1);
 	imageReadyFlag = ((int *)(&(PRUInterop1Data->imageReadyFlag)));
+	handshake = getPRUInterop1Handshake();
+	captureStatistics = &(PRUInterop1Data->captureStatistics);
+	captureHealth = &(PRUInterop1Data->captureHealth);
+	reportedAbandonedFrames = captureHealth->abandonedFrames;
+	segmentationConfiguration = &(PRUInterop1Data->segmentationConfiguration);
+	segmentationResult = &(PRUInterop1Data->segmentationResult);
+	visionManagerWriteSegmentationBox();
+	if(pruSegmentation && captureConfiguration.format != CAPTURE_FORMAT_RGB) printf("PRU segmentation needs the RGB capture format; thresholding on the ARM\n");
+	else if(pruSegmentation && !visionManagerPRUCanSegment()) printf("PRU segmentation at VGA needs a decimated capture; thresholding on the ARM\n");
+	if(sensorSize != Size(IMAGE_COLUMNS_IN_PIXELS_QVGA, IMAGE_ROWS_IN_PIXELS_QVGA)) printf("PRU1 is capturing at %dx%d\n", sensorSize.width, sensorSize.height);
+	if(thresholdLevel != 0) printf("Thresholding and display at %dx%d\n", processingImage.cols, processingImage.rows);
+	if(captureConfiguration.decimation != 1 || Size(inputSize) != sensorSize)
+	{
+		printf("Capturing %dx%d from sensor column %u, row %u, decimated by %u\n",
+				inputSize.width,
+				inputSize.height,
+				captureConfiguration.firstColumn,
+				captureConfiguration.firstRow,
+				captureConfiguration.decimation);
+	}
+	framePoolInitialize(inputSize, displayType);
+	visionMotionInitialize(&motionGate, inputSize, motionGateThreshold, motionGateMaxSkip);
+	visionFocusInitialize(&focus, inputSize, focusEnabled);
+	visionTrackerReset(&tracker);
+	visionSchedulerInitialize(&scheduler, schedulerBudgetMilliseconds);
+
+	if(recordingFile != NULL)
+	{
+		frameRecorderStart(recordingFile,
+							displayImage.cols,
+							displayImage.rows,
+							displayImage.type(),
+							displayImage.total() * displayImage.elemSize(),
+							captureConfiguration.orientation);
+	}
+	if(publishingName != NULL)
+	{
+		framePublisherStart(publishingName,
+							displayImage.cols,
+							displayImage.rows,
+							displayImage.type(),
+							displayImage.total() * displayImage.elemSize());
+	}
+
+	caffeModel.name = "Caffe";
+	caffeModel.modelFile = caffemodelFile;
+	caffeModel.configFile = prototxtFile;
+	caffeModel.net = &caffeNet;
+	caffeModel.config = &caffeNetworkConfig;
+	caffeModel.initialize = visionManagerInitializeCaffe;
+	caffeModel.state = MODEL_UNLOADED;
 
-	caffeNet = cv::dnn::readNet(caffemodelFile, prototxtFile);
-	darknetNet = cv::dnn::readNet(weightsFile, cfgFile);
+	darknetModel.name = "Darknet";
+	darknetModel.modelFile = weightsFile;
+	darknetModel.configFile = cfgFile;
+	darknetModel.net = &darknetNet;
+	darknetModel.config = &darknetNetworkConfig;
+	darknetModel.initialize = visionManagerInitializeDarknet;
+	darknetModel.state = MODEL_UNLOADED;
 
 	caffeConfidence = caffeConf;
 	darknetConfidence = darknetConf;
 	darknetNonMaximaSuppressionThreshold = darknetNMSThreshold;
 
-	visionManagerInitializeCaffe();
-	visionManagerInitializeDarknet();
-
 	string nameLine;
 
 	ifstream cnf(caffeNamesFile);
@@ -99,19 +911,55 @@ void visionManagerInitialize(const char *caffeNamesFile,
 	ifstream dnf(darknetNamesFile);
 	while (getline(dnf, nameLine)) darknetClasses.push_back(nameLine);
 
-	cvNamedWindow("Display_Image", CV_WINDOW_AUTOSIZE);
-	cvNamedWindow("Processing_Image", CV_WINDOW_AUTOSIZE);
-	setWindowTitle("Display_Image", "No Image Processing.");
-	setWindowTitle("Processing_Image", "Not Used.");
+	if(!headless)
+	{
+		cvNamedWindow("Display_Image", CV_WINDOW_AUTOSIZE);
+		cvNamedWindow("Processing_Image", CV_WINDOW_AUTOSIZE);
+	}
+	visionManagerSetTitles("No Image Processing.", "Not Used.");
+	return 0;
 }
 
 void visionManagerInitializeCaffe()
 {
-
+	visionPreprocessInitialize(&caffePreprocess,
+								captureImage.size(),
+								caffeNetworkConfig.inputSize,
+								0.007843f,
+								127.5f,
+								VISION_PREPROCESS_NETWORK_SWAP_RB,
+								NETWORK_INPUT_ORIENTATION);
+	visionPreprocessInitialize(&caffeFocusPreprocess,
+								captureImage.size() / FOCUS_WINDOW_DIVISOR,
+								caffeNetworkConfig.inputSize / FOCUS_WINDOW_DIVISOR,
+								0.007843f,
+								127.5f,
+								VISION_PREPROCESS_NETWORK_SWAP_RB,
+								NETWORK_INPUT_ORIENTATION);
 }
 
 void visionManagerInitializeDarknet()
 {
+	unconnectedOutputLayersNames.clear();
+	visionPreprocessInitialize(&darknetPreprocess,
+								captureImage.size(),
+								darknetNetworkConfig.inputSize,
+								0.007843f,
+								127.5f,
+								VISION_PREPROCESS_NETWORK_SWAP_RB,
+								NETWORK_INPUT_ORIENTATION);
+
+	Size focusInputSize = darknetNetworkConfig.inputSize / FOCUS_WINDOW_DIVISOR;
+	focusInputSize.width = max(focusInputSize.width / DARKNET_INPUT_ALIGNMENT, 1) * DARKNET_INPUT_ALIGNMENT;
+	focusInputSize.height = max(focusInputSize.height / DARKNET_INPUT_ALIGNMENT, 1) * DARKNET_INPUT_ALIGNMENT;
+	visionPreprocessInitialize(&darknetFocusPreprocess,
+								captureImage.size() / FOCUS_WINDOW_DIVISOR,
+								focusInputSize,
+								0.007843f,
+								127.5f,
+								VISION_PREPROCESS_NETWORK_SWAP_RB,
+								NETWORK_INPUT_ORIENTATION);
+
         vector<int> unconnectedOutputLayersIndices = darknetNet.getUnconnectedOutLayers();
         vector<String> outputLayersNames = darknetNet.getLayerNames();
         unconnectedOutputLayersNames.resize(unconnectedOutputLayersIndices.size());
@@ -119,47 +967,235 @@ void visionManagerInitializeDarknet()
         unconnectedOutputLayersNames[i] = outputLayersNames[unconnectedOutputLayersIndices[i] - 1];
 }
 
+void visionManagerConfigure(const char *configFile)
+{
+	if(visionAutotuneLoadConfig(configFile, &caffeNetworkConfig, &darknetNetworkConfig))
+	{
+		printf("Loaded vision configuration from %s\n", configFile);
+	}
+}
+
+int visionManagerAutotune(const char *framesDirectory, const char *configFile)
+{
+	vector<Mat> frames;
+
+	if(framesDirectory != NULL)
+	{
+		visionAutotuneLoadFrames(framesDirectory, captureImage.size(), frames);
+	}
+	else
+	{
+		while(frames.size() < VISION_AUTOTUNE_LIVE_FRAMES)
+		{
+			if(*imageReadyFlag == IMAGE_NOT_READY)
+			{
+				usleep(1000);
+				continue;
+			}
+			if(visionManagerFrameConfigured())
+			{
+				Mat frame;
+				visionManagerCopyCapture(frame, true);
+				frames.push_back(frame);
+			}
+			visionManagerReleaseFrame();
+		}
+	}
+	if(frames.empty())
+	{
+		fprintf(stderr, "No frames to autotune on.\n");
+		return -1;
+	}
+	printf("Autotuning on %d frames\n", (int)frames.size());
+
+	backgroundModelLoading = false;
+	modelMemoryBudget = 0;
+	visionManagerRequireModel(&caffeModel);
+	visionManagerRequireModel(&darknetModel);
+
+	visionAutotuneNetwork(caffeNet,
+							VISION_NETWORK_CAFFE,
+							vector<String>(),
+							frames,
+							caffeConfidence,
+							0,
+							VISION_AUTOTUNE_MIN_AGREEMENT,
+							&caffeNetworkConfig);
+	visionAutotuneNetwork(darknetNet,
+							VISION_NETWORK_DARKNET,
+							unconnectedOutputLayersNames,
+							frames,
+							darknetConfidence,
+							darknetNonMaximaSuppressionThreshold,
+							VISION_AUTOTUNE_MIN_AGREEMENT,
+							&darknetNetworkConfig);
+
+	visionManagerInitializeCaffe();
+	visionManagerInitializeDarknet();
+
+	if(!visionAutotuneSaveConfig(configFile, &caffeNetworkConfig, &darknetNetworkConfig))
+	{
+		fprintf(stderr, "Could not write vision configuration to %s\n", configFile);
+		return -1;
+	}
+	printf("Saved vision configuration to %s\n", configFile);
+	return 0;
+}
+
 void visionManagerUninitialize()
 {
-	cvDestroyWindow("Display_Image");
-	cvDestroyWindow("Processing_Image");
+	if(caffeModel.loader.joinable()) caffeModel.loader.join();
+	if(darknetModel.loader.joinable()) darknetModel.loader.join();
+	frameRecorderStop();
+	framePublisherStop();
+	framePoolRelease(currentFrame);
+	currentFrame = NULL;
+
+	if(motionGateThreshold > 0)
+	{
+		printf("Motion gate skipped %llu of %llu inferences\n",
+				(unsigned long long)motionGate.skipped,
+				(unsigned long long)(motionGate.skipped + motionGate.inferred));
+	}
+	if(focusEnabled)
+	{
+		printf("Focus processed an average of %.0f of %d pixels per frame\n",
+				visionFocusAveragePixels(&focus),
+				captureImage.cols * captureImage.rows);
+	}
+	visionSchedulerReport(&scheduler);
+	if(captureStatistics->busWrites > 0)
+	{
+		printf("PRU1 captured %u frames; the last took %u bus writes of %u bytes, %u cycles flushing lines, %u late line flushes in all\n",
+				captureStatistics->frames,
+				captureStatistics->busWrites,
+				captureStatistics->busWriteBytes,
+				captureStatistics->flushCycles,
+				captureStatistics->flushOverruns);
+	}
+	if(captureStatistics->frames > 0) visionManagerReportCaptureHealth(stdout);
+	if(captureStatistics->skippedFrames > 0)
+	{
+		printf("PRU1's capture governor let %u frames go by; frames were last wanted every %u VSYNCs and %.1f ms at least\n",
+				captureStatistics->skippedFrames,
+				max((uint32_t)captureGovernor->vsyncInterval, 1u),
+				captureGovernor->frameIntervalMicroseconds / 1000.0f);
+	}
+	visionManagerReportHandshake();
+
+	if(!headless)
+	{
+		cvDestroyWindow("Display_Image");
+		cvDestroyWindow("Processing_Image");
+	}
 }
 
 void visionManagerProcess(char key)
 {
-	if(*imageReadyFlag == IMAGE_NOT_READY) return;
-
+	/* Commands are taken whether or not a frame is ready, so none are lost between frames. */
+	if(key=='p') dumpRequested = true;
+	if(key=='n' || key=='t' || key=='k' || key=='c' || key=='d' || key=='a') visionTrackerReset(&tracker);
 	if(key=='n')
 	{
 		imageProcessingType=0;
-		setWindowTitle("Display_Image", "No Image Processing.");
-		setWindowTitle("Processing_Image", "Not Used.");
+		visionManagerSetTitles("No Image Processing.", "Not Used.");
 	}
 	if(key=='t')
 	{
 		imageProcessingType=1;
-		setWindowTitle("Display_Image", "Process Image By Threshold");
-		setWindowTitle("Processing_Image", "Image Moments");
+		visionFocusReset(&focus);
+		visionManagerSetTitles("Process Image By Threshold", "Image Moments");
 	}
 	if(key=='k')
 	{
 		imageProcessingType=2;
-		setWindowTitle("Display_Image", "Capture color key for Threshold");
-		setWindowTitle("Processing_Image", "Not Used.");
+		visionManagerSetTitles("Capture color key for Threshold", "Not Used.");
 	}
 	if(key=='c')
 	{
 		imageProcessingType=3;
-		setWindowTitle("Display_Image", "Process Image By Caffe");
-		setWindowTitle("Processing_Image", "Not Used.");
+		scheduler.network = VISION_TASK_CAFFE;
+		visionMotionReset(&motionGate);
+		visionFocusReset(&focus);
+		visionManagerRequireModel(&caffeModel);
+		visionManagerSetTitles("Process Image By Caffe", "Not Used.");
 	}
 	if(key=='d')
 	{
 		imageProcessingType=4;
-		setWindowTitle("Display_Image", "Process Image By Darknet");
-		setWindowTitle("Processing_Image", "Not Used.");
+		scheduler.network = VISION_TASK_DARKNET;
+		visionMotionReset(&motionGate);
+		visionFocusReset(&focus);
+		visionManagerRequireModel(&darknetModel);
+		visionManagerSetTitles("Process Image By Darknet", "Not Used.");
+	}
+	if(key=='a')
+	{
+		imageProcessingType=5;
+		visionMotionReset(&motionGate);
+		visionFocusReset(&focus);
+		visionManagerRequireModel((scheduler.network == VISION_TASK_CAFFE) ? &caffeModel : &darknetModel);
+		visionManagerSetTitles("Process Image By Schedule", "Image Moments");
+	}
+
+	if(*imageReadyFlag == IMAGE_NOT_READY) return;
+	visionManagerCheckCaptureHealth();
+	if(!visionManagerFrameConfigured())
+	{
+		visionManagerReleaseFrame();
+		return;
 	}
 
+	/*
+	 * The one copy out of the carveout. If every pool buffer is still held elsewhere
+	 * the frame stays with the PRU and we try again next time round. Thresholding on
+	 * PRU1's segmentation with nothing to show, record or publish, there is no copy;
+	 * that is decided on whether PRU1 actually segmented this frame, not on whether
+	 * it was asked to, as the threshold mode falls back to the pixels when it didn't.
+	 */
+	visionManagerReadSegmentation();
+	bool frameNeeded = !(frameSegmented &&
+							imageProcessingType == 1 &&
+							!visionManagerDrawing() &&
+							recordingFile == NULL &&
+							publishingName == NULL);
+	FRAME_POOL_FRAME *frame = NULL;
+	if(frameNeeded)
+	{
+		frame = framePoolAcquire();
+		if(frame == NULL) return;
+	}
+	frameTimestamp = frameRecordingNow();
+	if(frameNeeded)
+	{
+		frame->timestamp = frameTimestamp;
+		visionManagerCopyCapture(frame->image, false);
+	}
+	visionManagerWriteSegmentationBox();
+	visionManagerReleaseFrame();
+
+	if(frameNeeded)
+	{
+		framePoolRelease(currentFrame);
+		currentFrame = frame;
+		displayImage = frame->image;
+		visionPyramidSetFrame(&pyramid, displayImage);
+
+		if(recordingFile != NULL) frameRecorderWrite(displayImage.data, frameTimestamp);
+		framePublisherBegin(displayImage.data, frameTimestamp);
+	}
+
+	if(!firstFrameReported)
+	{
+		firstFrameReported = true;
+		printf("First frame %.0f ms after start, resident %ld KB\n",
+				visionManagerSecondsSinceStart() * 1000.0,
+				visionManagerResidentBytes() / 1024);
+	}
+
+	frameTasks = 0;
+	int64 processingStart = getTickCount();
+
 	switch(imageProcessingType)
 	{
 		case 0:
@@ -177,45 +1213,172 @@ void visionManagerProcess(char key)
 		case 4:
 			visionManagerProcessDarknet();
 			break;
+		case 5:
+			visionManagerProcessScheduled();
+			break;
 	}
 
-	*imageReadyFlag = IMAGE_NOT_READY;
+	float processingMilliseconds = visionManagerMillisecondsSince(processingStart);
+	if(imageProcessingType == 5)
+	{
+		visionSchedulerFinish(&scheduler, processingMilliseconds);
+		framePublisherSchedule(frameTasks, scheduler.budget, processingMilliseconds, scheduler.slack);
+	}
+	else
+	{
+		framePublisherSchedule(frameTasks, 0, processingMilliseconds, 0);
+	}
+	if(captureGoverned) visionManagerGovernCapture((imageProcessingType == 5) ? visionSchedulerCaptureInterval(&scheduler) : 0);
+
+	switch(imageProcessingType)
+	{
+		case 1:
+			framePublisherEnd(FRAME_PUBLISHER_MODE_THRESHOLD, NULL, thresholdArea, thresholdPosition.x, thresholdPosition.y);
+			break;
+		case 3:
+			framePublisherEnd(FRAME_PUBLISHER_MODE_CAFFE, (caffeModel.state == MODEL_LOADED) ? &caffeDetections : NULL, 0, 0, 0);
+			break;
+		case 4:
+			framePublisherEnd(FRAME_PUBLISHER_MODE_DARKNET, (darknetModel.state == MODEL_LOADED) ? &darknetDetections : NULL, 0, 0, 0);
+			break;
+		case 5:
+			framePublisherEnd(FRAME_PUBLISHER_MODE_SCHEDULED,
+								(scheduler.network == VISION_TASK_CAFFE) ? &caffeDetections : &darknetDetections,
+								thresholdArea,
+								thresholdPosition.x,
+								thresholdPosition.y);
+			break;
+		default:
+			framePublisherEnd(FRAME_PUBLISHER_MODE_NONE, NULL, 0, 0, 0);
+			break;
+	}
 }
 
 void visionManagerProcessNone()
 {
-	imshow("Display_Image", displayImage);
-	imshow("Processing_Image", processingImage);
+	visionManagerShow(displayImage, processingImage);
 }
 
-void visionManagerProcessThreshold()
+void visionManagerProcessLoading(const char *modelName)
 {
+	if(visionManagerDrawing()) putText(displayImage, format("Loading %s model...", modelName), Point(0, 15), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+	visionManagerShow(displayImage, processingImage);
+}
+
+/*
+ * Thresholds the frame and draws the result, but leaves showing it to the caller, so
+ * the scheduled mode can add a network's results to the same frame.
+ */
+static void visionManagerRunThreshold()
+{
+	int64 start = getTickCount();
 	double area = 0;
 	CvPoint position;
 	char outputMessage[50];
 
 	/*
-	 * Not sure why, but in this version (Debian 9.5), trying to pass the
-	 * displayImage and processingImage directly like in previous versions
-	 * crashes the entire system! Cloning the images like this works fine...
+	 * On Debian 9.5, working directly on the carveout here crashed the entire system,
+	 * so this used to clone the frame twice. displayImage is a frame pool buffer now,
+	 * plain cached memory the PRU never touches, so it is used in place.
 	 */
 
-	Mat display = displayImage.clone();
-	Mat processing = displayImage.clone();
+	Rect window = visionFocusWindow(&focus, Size());
+	const int scale = visionPyramidScale(thresholdLevel);
+	cv::Moments moments;
+	if(frameSegmented)
+	{
+		/*
+		 * PRU1 covered the whole frame, in sensor order; flip its moments into ours
+		 * along whichever axes are stored backwards, scaled by 255 to match those of an
+		 * inRange mask.
+		 */
+		const double m00 = frameSegmentation.m00;
+		const bool columnsForward = CAPTURE_COLUMNS_FORWARD(captureConfiguration.orientation);
+		const bool rowsForward = CAPTURE_ROWS_FORWARD(captureConfiguration.orientation);
+		window = Rect(Point(0, 0), displayImage.size());
+		moments.m00 = 255.0 * m00;
+		moments.m10 = 255.0 * (columnsForward ? (double)frameSegmentation.m10 : m00 * (window.width - 1) - frameSegmentation.m10);
+		moments.m01 = 255.0 * (rowsForward ? (double)frameSegmentation.m01 : m00 * (window.height - 1) - frameSegmentation.m01);
+		if(visionManagerDrawing())
+		{
+			/* the runs are in frame pixels; the mask shown is at the threshold level */
+			processingImage.setTo(Scalar(0));
+			for(uint32_t i = 0; i < frameSegmentation.runCount; i++)
+			{
+				const SEGMENTATION_RUN &run = frameSegmentation.runs[i];
+				int row = rowsForward ? run.row : window.height - 1 - run.row;
+				Range columns = columnsForward ? Range(run.start, run.end) : Range(window.width - run.end, window.width - run.start);
+				columns = Range(columns.start / scale, max((columns.end + scale - 1) / scale, columns.start / scale + 1));
+				processingImage.row(min(row / scale, processingImage.rows - 1)).colRange(columns & Range(0, processingImage.cols)).setTo(Scalar(255));
+			}
+		}
+	}
+	else
+	{
+		/*
+		 * Work on the threshold level, over the part of it the window covers, then turn
+		 * the moments into the frame's pixels (each level pixel standing for a scale by
+		 * scale block, centred in it) relative to the block-aligned window.
+		 */
+		const Mat &level = visionPyramidLevel(&pyramid, thresholdLevel);
+		Rect levelWindow = Rect(window.x / scale,
+								window.y / scale,
+								(window.width + scale - 1) / scale,
+								(window.height + scale - 1) / scale) & Rect(Point(0, 0), level.size());
+		window = Rect(levelWindow.tl() * scale, levelWindow.size() * scale);
+		if(levelWindow.size() != level.size() && visionManagerDrawing()) processingImage.setTo(Scalar(0));
 
-	inRange(display, thresholdLow, thresholdHigh, processing);
-	cv::Moments moments = cv::moments(processing, false);
+		Mat mask = processingImage(levelWindow);
+		inRange(level(levelWindow), thresholdLow, thresholdHigh, mask);
+		moments = cv::moments(mask, false);
+		const double area = (double)scale * scale;
+		const double offset = (scale - 1) / 2.0;
+		moments.m10 = area * (scale * moments.m10 + offset * moments.m00);
+		moments.m01 = area * (scale * moments.m01 + offset * moments.m00);
+		moments.m00 = area * moments.m00;
+	}
 	area = moments.m00;
+	thresholdArea = 0;
 	if (area > 1000000)
 	{
-		position.x = moments.m10 / area;
-		position.y = moments.m01 / area;
+		position.x = window.x + moments.m10 / area;
+		position.y = window.y + moments.m01 / area;
+		thresholdArea = area;
+		thresholdPosition = Point(position.x, position.y);
+
+		/* The mask is 255 where it matches, so this is the side of a square of the same area. */
+		int side = sqrt(area / 255);
+		Rect target(position.x - side / 2, position.y - side / 2, side, side);
+		visionFocusUpdate(&focus, &target);
+
+		Point2f center(moments.m10 / area + window.x, moments.m01 / area + window.y);
+		int classId = VISION_TRACKER_THRESHOLD_CLASS;
+		visionTrackerUpdate(&tracker, frameTimestamp, &center, &classId, 1);
+	}
+	else
+	{
+		visionFocusUpdate(&focus, NULL);
+		visionTrackerUpdate(&tracker, frameTimestamp, NULL, NULL, 0);
+	}
+	visionManagerRecordTask(VISION_TASK_THRESHOLD, start);
+
+	if (visionManagerDrawing())
+	{
+		visionManagerDrawFocus(window);
+		visionManagerDrawPrediction();
+	}
+	if (area > 1000000 && visionManagerDrawing())
+	{
 		sprintf(outputMessage, "pos: %d, %d", position.x, position.y);
-		rectangle(display, cvPoint(position.x - 5, position.y - 5), cvPoint(position.x + 5, position.y + 5), cvScalar(0, 255, 0, 0), 1, 8, 0);
-		putText(display, outputMessage, Point(position.x + 10, position.y + 5), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		rectangle(displayImage, cvPoint(position.x - 5, position.y - 5), cvPoint(position.x + 5, position.y + 5), cvScalar(0, 255, 0, 0), 1, 8, 0);
+		putText(displayImage, outputMessage, Point(position.x + 10, position.y + 5), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
 	}
-	imshow("Display_Image", display);
-	imshow("Processing_Image", processing);
+}
+
+void visionManagerProcessThreshold()
+{
+	visionManagerRunThreshold();
+	visionManagerShow(displayImage, processingImage);
 }
 
 void visionManagerCaptureThreshold()
@@ -227,150 +1390,150 @@ void visionManagerCaptureThreshold()
 	double maxR;
 	double maxG;
 	double maxB;
-	Mat bgr[3];
-
-	if(*imageReadyFlag == IMAGE_NOT_READY) return;
+	static Mat bgr[3];
 
 	split(displayImage(thresholdROI), bgr);
 	minMaxLoc(bgr[0], &minR, &maxR);
-	minMaxLoc(bgr[1], &minG, &maxG);
-	minMaxLoc(bgr[2], &minB, &maxB);
+	if(displayImage.channels() == 1)
+	{
+		/* luma only: inRange only looks at the first bound */
+		minG = minB = minR;
+		maxG = maxB = maxR;
+	}
+	else
+	{
+		minMaxLoc(bgr[1], &minG, &maxG);
+		minMaxLoc(bgr[2], &minB, &maxB);
+	}
 
 	thresholdLow = Scalar(minR, minG, minB);
 	thresholdHigh = Scalar(maxR, maxG, maxB);
 
-	putText(displayImage, format("minR: %f", minR), Point(0, 10), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	putText(displayImage, format("minG: %f", minG), Point(0, 25), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	putText(displayImage, format("minB: %f", minB), Point(0, 40), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	putText(displayImage, format("maxR: %f", maxR), Point(0, 55), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	putText(displayImage, format("maxG: %f", maxG), Point(0, 70), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	putText(displayImage, format("maxB: %f", maxB), Point(0, 85), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	rectangle(displayImage, thresholdROI, Scalar(0, 255, 0), 1, 8, 0);
+	if(visionManagerDrawing())
+	{
+		putText(displayImage, format("minR: %f", minR), Point(0, 10), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		putText(displayImage, format("minG: %f", minG), Point(0, 25), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		putText(displayImage, format("minB: %f", minB), Point(0, 40), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		putText(displayImage, format("maxR: %f", maxR), Point(0, 55), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		putText(displayImage, format("maxG: %f", maxG), Point(0, 70), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		putText(displayImage, format("maxB: %f", maxB), Point(0, 85), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
+		rectangle(displayImage, thresholdROI, Scalar(0, 255, 0), 1, 8, 0);
+	}
 
-	imshow("Display_Image", displayImage);
-	imshow("Processing_Image", processingImage);
+	visionManagerShow(displayImage, processingImage);
 }
 
-void visionManagerProcessCaffe()
+/*
+ * Runs a network on the frame if the motion gate lets it through, on the focus window
+ * when focused is set and on the whole frame otherwise, and feeds the detections to
+ * the tracker (and the focus). Nothing is drawn but the window. Returns true if the
+ * network ran.
+ */
+static bool visionManagerRunCaffe(bool focused)
 {
-	const Size resized(320, 240);
-	Point position;
+	if(!visionMotionShouldInfer(&motionGate, displayImage)) return false;
 
-	char outputMessage[64];
+	int64 start = getTickCount();
+	Rect window = focused ? visionFocusWindow(&focus, caffeFocusPreprocess.inputSize) : Rect(Point(0, 0), displayImage.size());
+	VISION_PREPROCESS *plan = (window.size() == displayImage.size()) ? &caffePreprocess : &caffeFocusPreprocess;
+	Mat view = displayImage(window);
 
-	if(*imageReadyFlag == IMAGE_NOT_READY) return;
-
-	//resize(displayImage, processingImage, resized, 0, 0, CV_INTER_LINEAR);
-	Mat blob = cv::dnn::blobFromImage(displayImage,
-										0.007843f,
-										resized,
-										Scalar(127.5));
-	caffeNet.setInput(blob);
+	caffeNet.setInput(visionPreprocessRun(plan, visionManagerNetworkView(view)));
 	Mat detections = caffeNet.forward();
-	for(int i = 0; i < detections.size[2]; i++)
-	{
-		int idxConf[4] = {0, 0, i, 2};
-		float conf = detections.at<float>(idxConf);
 
-		if(conf > caffeConfidence)
-		{
-			int idxCls[4] = {0, 0, i, 1};
-			int cls = detections.at<float>(idxCls);
-
-			int leftPercent[4] = {0, 0, i, 3};
-			int topPercent[4] = {0, 0, i, 4};
-			int widthPercent[4] = {0, 0, i, 5};
-			int heightPercent[4] = {0, 0, i, 6};
-
-			position.x = detections.at<float>(leftPercent) * resized.width;
-			position.y = detections.at<float>(topPercent) * resized.height;
-			int width = (detections.at<float>(widthPercent) * resized.width) - position.x;
-			int height = (detections.at<float>(heightPercent) * resized.height) - position.y;
-
-			Rect detection(position.x, position.y, width, height);
-			rectangle(displayImage, detection, Scalar(0, 255, 0), 1, 8, 0);
-			string label = format("%.2f", conf);
-			if (!caffeClasses.empty())
-			{
-				CV_Assert(cls < (int)caffeClasses.size());
-				label = caffeClasses[cls] + ":" + label;
-			}
-			putText(displayImage, label, Point(position.x, position.y + 10), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-		}
+	visionDetectionsDecodeSSD(detections, caffeConfidence, view.size(), &caffeDetections);
+	for(int i = 0; i < caffeDetections.count; i++) caffeDetections.box[i] = visionPreprocessToFrame(plan, caffeDetections.box[i], view.size()) + window.tl();
+	if(focused) visionFocusUpdateDetections(&focus, &caffeDetections);
+	visionTrackerUpdateDetections(&tracker, frameTimestamp, &caffeDetections);
+	visionManagerRecordTask(VISION_TASK_CAFFE, start);
+
+	if(visionManagerDrawing()) visionManagerDrawFocus(window);
+	return true;
+}
+
+static bool visionManagerRunDarknet(bool focused)
+{
+	if(!visionMotionShouldInfer(&motionGate, displayImage)) return false;
+
+	int64 start = getTickCount();
+	Rect window = focused ? visionFocusWindow(&focus, darknetFocusPreprocess.inputSize) : Rect(Point(0, 0), displayImage.size());
+	VISION_PREPROCESS *plan = (window.size() == displayImage.size()) ? &darknetPreprocess : &darknetFocusPreprocess;
+	Mat view = displayImage(window);
+
+	darknetNet.setInput(visionPreprocessRun(plan, visionManagerNetworkView(view)));
+	darknetNet.forward(darknetOutputs, unconnectedOutputLayersNames);
+
+	visionDetectionsDecodeDarknet(darknetOutputs, darknetConfidence, view.size(), &darknetDetections);
+	visionDetectionsNMS(&darknetDetections, darknetNonMaximaSuppressionThreshold);
+	for(int i = 0; i < darknetDetections.count; i++) darknetDetections.box[i] = visionPreprocessToFrame(plan, darknetDetections.box[i], view.size()) + window.tl();
+	if(focused) visionFocusUpdateDetections(&focus, &darknetDetections);
+	visionTrackerUpdateDetections(&tracker, frameTimestamp, &darknetDetections);
+	visionManagerRecordTask(VISION_TASK_DARKNET, start);
+
+	if(visionManagerDrawing()) visionManagerDrawFocus(window);
+	return true;
+}
+
+void visionManagerProcessCaffe()
+{
+	if(!visionManagerRequireModel(&caffeModel))
+	{
+		visionManagerProcessLoading(caffeModel.name);
+		return;
 	}
-	imshow("Display_Image", displayImage);
-	imshow("Processing_Image", processingImage);
+
+	visionManagerRunCaffe(true);
+	if(visionManagerDrawing()) visionManagerDrawPrediction();
+
+	if(visionManagerDrawing()) visionDetectionsDraw(displayImage, &caffeDetections, caffeClasses, 10);
+	visionManagerShow(displayImage, processingImage);
 }
 
 void visionManagerProcessDarknet()
 {
-	const Size resized(192, 192);
-	Point position;
-	vector<int> classIds;
-	vector<float> confidences;
-	vector<Rect> boxes;
+	if(!visionManagerRequireModel(&darknetModel))
+	{
+		visionManagerProcessLoading(darknetModel.name);
+		return;
+	}
 
-	char outputMessage[64];
+	visionManagerRunDarknet(true);
+	if(visionManagerDrawing()) visionManagerDrawPrediction();
 
-	if(*imageReadyFlag == IMAGE_NOT_READY) return;
+	if(visionManagerDrawing()) visionDetectionsDraw(displayImage, &darknetDetections, darknetClasses, 0);
+	visionManagerShow(displayImage, processingImage);
+}
 
-	//resize(displayImage, processingImage, resized, 0, 0, CV_INTER_LINEAR);
-	Mat blob = cv::dnn::blobFromImage(displayImage,
-										0.007843f,
-										resized,
-										Scalar(127.5));
-     
-	darknetNet.setInput(blob);
-	vector<Mat> outs;
-	darknetNet.forward(outs, unconnectedOutputLayersNames);
-
-    	for (size_t i = 0; i < outs.size(); ++i)
-    	{
-        	// Scan through all the bounding boxes output from the network and keep only the
-        	// ones with high confidence scores. Assign the box's class label as the class
-        	// with the highest score for the box.
-        	float* data = (float*)outs[i].data;
-        	for (int j = 0; j < outs[i].rows; ++j, data += outs[i].cols)
-        	{
-            		Mat scores = outs[i].row(j).colRange(5, outs[i].cols);
-            		Point classIdPoint;
-            		double confidence;
-            		// Get the value and location of the maximum score
-            		minMaxLoc(scores, 0, &confidence, 0, &classIdPoint);
-            		if (confidence > darknetConfidence)
-            		{
-                		int centerX = (int)(data[0] * displayImage.cols);
-                		int centerY = (int)(data[1] * displayImage.rows);
-                		int width = (int)(data[2] * displayImage.cols);
-                		int height = (int)(data[3] * displayImage.rows);
-                		int left = centerX - width / 2;
-                		int top = centerY - height / 2;
-
-                		classIds.push_back(classIdPoint.x);
-                		confidences.push_back((float)confidence);
-                		boxes.push_back(Rect(left, top, width, height));
-            		}
-        	}
-    	}
-
-    	// Perform non maximum suppression to eliminate redundant overlapping boxes with
-    	// lower confidences
-    	vector<int> indices;
-    	NMSBoxes(boxes, confidences, darknetConfidence, darknetNonMaximaSuppressionThreshold, indices);
-
-    	for (size_t i = 0; i < indices.size(); ++i)
-    	{
-        	int idx = indices[i];
-        	Rect box = boxes[idx];
-    		rectangle(displayImage, Point(box.x, box.y), Point(box.x + box.width, box.y + box.height), Scalar(0, 255, 0), 1, 8, 0);
-    		string label = format("%.2f", confidences[idx]);
-    		if (!darknetClasses.empty())
-    		{
-        		CV_Assert(classIds[idx] < (int)darknetClasses.size());
-        		label = darknetClasses[classIds[idx]] + ":" + label;
-    		}
-    		putText(displayImage, label, Point(box.x, box.y), CV_FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0), 2, 8, false);
-	}
-	imshow("Display_Image", displayImage);
-	imshow("Processing_Image", processingImage);
+/*
+ * Thresholding has the focus window to itself here; the network, when the scheduler
+ * fits it in, looks at the whole frame so the two don't fight over where the target is.
+ */
+void visionManagerProcessScheduled()
+{
+	const bool caffe = (scheduler.network == VISION_TASK_CAFFE);
+	VISION_MODEL *model = caffe ? &caffeModel : &darknetModel;
+	uint32_t decision = visionSchedulerDecide(&scheduler, visionManagerRequireModel(model));
+
+	visionManagerRunThreshold();
+	if(decision & VISION_TASK_BIT(VISION_TASK_CAFFE)) visionManagerRunCaffe(false);
+	if(decision & VISION_TASK_BIT(VISION_TASK_DARKNET)) visionManagerRunDarknet(false);
+
+	if(visionManagerDrawing())
+	{
+		if(model->state == MODEL_LOADED)
+		{
+			if(caffe) visionDetectionsDraw(displayImage, &caffeDetections, caffeClasses, 10);
+			else visionDetectionsDraw(displayImage, &darknetDetections, darknetClasses, 0);
+		}
+		putText(displayImage,
+				format("%s%s, slack %.0f ms", (frameTasks & VISION_TASK_BIT(VISION_TASK_THRESHOLD)) ? "T" : "", (frameTasks & ~VISION_TASK_BIT(VISION_TASK_THRESHOLD)) ? (caffe ? "+C" : "+D") : "", scheduler.slack),
+				Point(0, displayImage.rows - 5),
+				CV_FONT_HERSHEY_SIMPLEX,
+				0.5,
+				Scalar(0, 255, 0),
+				2,
+				8,
+				false);
+	}
+	visionManagerShow(displayImage, processingImage);
 }
@@ -22,6 +22,13 @@
 #ifndef VISIONMANAGER_HPP_
 #define VISIONMANAGER_HPP_
 
+#include <stdint.h>
+
+#define VISION_DUMP_DEFAULT_PREFIX			"frame_"
+#define VISION_FRAME_POLL_MICROSECONDS		500
+#define VISION_PREDICTION_DEFAULT_LATENCY_MS	100
+#define VISION_SENSOR_TIMEOUT_MS			1000
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -34,15 +41,18 @@ extern "C" {
  * 	function also sets up two image instances in memory, one just using the pointer to the
  * 	PRU driver allocated memory, the other having its own image memory to hold the masked
  * 	image processed by cvMoments. It also creates two windows, one for each of the images.
- * 	Also sets up the font to write text to the image windows.
+ * 	Also sets up the font to write text to the image windows. The sensor resolution
+ * 	(QVGA or VGA, whichever the PRU1 firmware was built for) is read from the carveout,
+ * 	waiting up to VISION_SENSOR_TIMEOUT_MS for PRU1 to write it.
  *
  *	@param	namesFile the file with the list of class names
  *	@param	modelFile the file that defines the DNN network
  *	@param	weightsFile the file containing the weights for the network
- * 	@return void.
+ * 	@return 0 on success, -1 if a recording was asked for with a capture configuration
+ * 			that doesn't deliver whole RGB or UYVY frames (see visionManagerSetRecording).
  *
  */
-void visionManagerInitialize(const char *caffeNamesFile,
+int visionManagerInitialize(const char *caffeNamesFile,
 								const char *prototxtFile,
 								const char *caffemodelFile,
 								float caffeConf,
@@ -52,6 +62,317 @@ void visionManagerInitialize(const char *caffeNamesFile,
 								float darknetConf,
 								float darknetNMSThreshold);
 
+/** @brief Loads the persisted network configuration
+ *
+ *	Reads the backend, target and input resolution to use for each network from a file
+ *	written by visionManagerAutotune. Must be called before visionManagerInitialize to
+ *	have any effect. If the file doesn't exist the defaults (OpenCV's default backend
+ *	on the CPU, 320x240 for Caffe and 192x192 for Darknet) are kept.
+ *
+ *	@param	configFile the configuration file.
+ * 	@return void.
+ *
+ */
+void visionManagerConfigure(const char *configFile);
+
+/** @brief Records every frame PRU1 delivers to a file
+ *
+ *	Frames are recorded as they arrive, before any processing draws on them, along
+ *	with their arrival time. See frameRecording.hpp for the file format. Must be called
+ *	before visionManagerInitialize. Recordings are of whole sensor frames in BGR, which
+ *	is what replay expects, so the capture must be the whole frame, undecimated, in the
+ *	RGB or UYVY format; visionManagerInitialize fails otherwise.
+ *
+ *	@param	filename the recording to create.
+ * 	@return void.
+ *
+ */
+void visionManagerSetRecording(const char *filename);
+
+/** @brief Publishes every processed frame and its results to shared memory
+ *
+ *	Other local processes can then attach to the ring read only and use the latest
+ *	frame and its detections (or threshold blob) in place. See framePublisher.hpp for
+ *	the layout and the reader functions. Must be called before visionManagerInitialize.
+ *
+ *	@param	name the POSIX shared memory name, or NULL for FRAME_PUBLISHER_DEFAULT_NAME.
+ * 	@return void.
+ *
+ */
+void visionManagerSetPublishing(const char *name);
+
+/** @brief Skips the networks on frames where nothing has changed
+ *
+ *	In the Caffe and Darknet modes, a cheap change detector (see visionMotion.hpp) is
+ *	run on every frame first, and the network only on frames where the scene has
+ *	changed; the last detections are reused for the rest. The number of inferences
+ *	skipped is printed by visionManagerUninitialize. Must be called before
+ *	visionManagerInitialize.
+ *
+ *	@param	threshold the luma change, in levels, for part of the scene to count as
+ *			changed. Lower is more sensitive; negative for a sensible default, 0 (the
+ *			default if this isn't called) to run every frame.
+ *	@param	maxSkip the most frames in a row that may be skipped, or 0 for the default.
+ * 	@return void.
+ *
+ */
+void visionManagerSetMotionGate(int threshold, int maxSkip);
+
+/** @brief Processes only a window around the last known target
+ *
+ *	Once the threshold tracker or a network has found something, the next frame is only
+ *	processed in a search window around where it should be (see visionFocus.hpp); the
+ *	networks look at a window half the size of the frame through an input half their
+ *	usual size. After a few frames without finding it, the whole frame is processed
+ *	again. The average number of pixels processed per frame is printed by
+ *	visionManagerUninitialize. Must be called before visionManagerInitialize.
+ *
+ *	@param	enable non-zero to focus on the target.
+ * 	@return void.
+ *
+ */
+void visionManagerSetFocus(int enable);
+
+/** @brief Sets how far ahead visionManagerPredictTarget looks
+ *
+ *	This should be the time from a frame being captured to something acting on what was
+ *	found in it: capture, handoff, inference and the command getting to the servos.
+ *
+ *	@param	milliseconds the latency to compensate for.
+ * 	@return void.
+ *
+ */
+void visionManagerSetPredictionLatency(int milliseconds);
+
+/** @brief Gets where the target being followed will be once the latency has passed
+ *
+ *	Targets found by the threshold mode and the networks are tracked with a constant
+ *	velocity Kalman filter per target (see visionTracker.hpp), using the time each frame
+ *	was captured. This predicts the most often seen target forward to now plus the
+ *	configured latency, so it can be called at control rate, as often as needed,
+ *	between detections. The velocity is in the image, so it includes any motion of the
+ *	camera itself.
+ *
+ *	@param	x set to the predicted x, in frame pixels.
+ *	@param	y set to the predicted y, in frame pixels.
+ * 	@return 1 if there is a target, 0 if not (x and y are left alone).
+ *
+ */
+int visionManagerPredictTarget(float *x, float *y);
+
+/** @brief Gets where the target being followed was last measured, and when
+ *
+ *	The centre found in the most recent frame the most often seen target was matched
+ *	in, unfiltered, with that frame's capture time. The two belong together: something
+ *	that moves the camera can pair them with where the camera was at that time. The
+ *	centre is mapped out of the capture window and decimation to full frame pixels,
+ *	the same way round as the frame is stored, so it means the same direction whatever
+ *	window is captured.
+ *
+ *	@param	x set to the measured x, in full frame pixels.
+ *	@param	y set to the measured y, in full frame pixels.
+ *	@param	measured set to the capture time of the frame, on the frameRecordingNow
+ *			clock, so callers can tell a new measurement from a repeat.
+ * 	@return 1 if there is a target, 0 if not (x, y and measured are left alone).
+ *
+ */
+int visionManagerMeasuredTarget(float *x, float *y, uint64_t *measured);
+
+/** @brief Sets the per-frame processing budget for the scheduled mode
+ *
+ *	Pressing 'a' hands the choice of processing to a scheduler (see visionScheduler.hpp)
+ *	which thresholds every frame and runs the network last selected with 'c' or 'd'
+ *	(Darknet if neither has been) as often as the budget allows on average, based on
+ *	how long each has been taking. Must be called before visionManagerInitialize.
+ *
+ *	@param	milliseconds the processing time allowed per frame.
+ * 	@return void.
+ *
+ */
+void visionManagerSetFrameBudget(int milliseconds);
+
+/** @brief Tells the scheduler whether the control loop needs the processor
+ *
+ *	While it does, the scheduled mode only thresholds, keeping frame rate up for the
+ *	loop acting on the results.
+ *
+ *	@param	demand non-zero while the control loop needs the processor.
+ * 	@return void.
+ *
+ */
+void visionManagerSetControlDemand(int demand);
+
+/** @brief Sets the part of the sensor's frame to capture, and how much to decimate it
+ *
+ *	PRU1 only stores the window, keeping every decimation'th pixel of every
+ *	decimation'th line of it, so the frame everything downstream works on is the
+ *	window's size divided by the decimation, and the DDR traffic and copies shrink with
+ *	it. The window is rounded to what PRU1 can capture: its width to a multiple of
+ *	4 x decimation pixels, its height to a multiple of the decimation, and its right
+ *	edge to a 4 pixel boundary, and clipped to the sensor's resolution. Must be called
+ *	before visionManagerInitialize.
+ *
+ *	@param	x the window's left edge, in full frame pixels.
+ *	@param	y the window's top edge, in full frame pixels.
+ *	@param	width the window's width; 0 for the whole frame.
+ *	@param	height the window's height; 0 for the whole frame.
+ *	@param	decimation 1, 2 or 4.
+ * 	@return void.
+ *
+ */
+void visionManagerSetCaptureWindow(int x, int y, int width, int height, int decimation);
+
+/** @brief Gets the size of the sensor's full frame
+ *
+ *	Valid after visionManagerInitialize; this is the resolution PRU1 reported, and the
+ *	frame visionManagerMeasuredTarget gives positions in, whatever the capture window.
+ *
+ *	@param	width set to the full frame's width.
+ *	@param	height set to the full frame's height.
+ * 	@return void.
+ *
+ */
+void visionManagerGetSensorSize(int *width, int *height);
+
+/** @brief Sets which way round PRU1 stores the frame
+ *
+ *	Relative to the sensor's scan: CAPTURE_ORIENTATION_ROTATED (the default, and the
+ *	original layout) is rotated 180 degrees, _FLIPPED upside down, _MIRRORED left to
+ *	right, and _NORMAL as scanned. PRU1 does the reordering as it stores the pixels, so
+ *	no pass over the frame is needed for it, and with _NORMAL it writes the frame front
+ *	to back. Calibrations made on frames in one orientation (the look-at table, the
+ *	capture window) need redoing for another. Must be called before
+ *	visionManagerInitialize.
+ *
+ *	@param	orientation one of the CAPTURE_ORIENTATION_ values.
+ * 	@return void.
+ *
+ */
+void visionManagerSetCaptureOrientation(int orientation);
+
+/** @brief Has PRU1 do the threshold mode's segmentation
+ *
+ *	PRU1 classifies each pixel of an RGB capture against the threshold box as it
+ *	arrives and hands over the matching runs and the mask's moments, so thresholding
+ *	costs the ARM next to nothing, and headless with nothing recorded or published the
+ *	frame isn't copied out at all. The PRU always segments the whole frame, so the
+ *	focus window doesn't narrow it. Ignored for other capture formats, and at VGA
+ *	unless the capture is decimated, where there isn't time between pixel clocks for
+ *	it. Must be called before visionManagerInitialize.
+ *
+ *	@param	enable non-zero to segment on PRU1.
+ * 	@return void.
+ *
+ */
+void visionManagerSetPRUSegmentation(int enable);
+
+/** @brief Has PRU1 draw its test pattern instead of capturing
+ *
+ *	PRU1 leaves the camera alone and delivers moving colour bars with a pink square
+ *	over them (see TEST_PATTERN_CONFIGURATION), in the configured window, format and
+ *	orientation and through the same handshake, so the rest of the pipeline can be run
+ *	and timed with no camera attached. Must be called before visionManagerInitialize.
+ *
+ *	@param	enable non-zero to draw the test pattern.
+ *	@param	framesPerSecond the most frames PRU1 draws a second, 0 for as fast as they
+ *			are taken.
+ * 	@return void.
+ *
+ */
+void visionManagerSetTestPattern(int enable, int framesPerSecond);
+
+/** @brief Sets how often PRU1 captures a frame
+ *
+ *	PRU1 lets whole frames go by at VSYNC, without capturing or writing anything,
+ *	unless it is the every'th VSYNC since the last frame it captured and at least the
+ *	interval has passed (see CAPTURE_GOVERNOR), so when processing can't keep up with
+ *	the camera the frames it would never look at cost neither bus bandwidth nor PRU
+ *	cycles, and the frame it does get is fresher. Governed, the scheduled mode
+ *	stretches the interval to match the processing time it is using per frame
+ *	(visionSchedulerCaptureInterval); the interval given is still the least. Must be
+ *	called before visionManagerInitialize.
+ *
+ *	@param	every capture one frame in this many (1 for every frame).
+ *	@param	intervalMilliseconds the least time between captured frames, 0 for none.
+ *	@param	governed non-zero to let the scheduler lengthen the interval.
+ * 	@return void.
+ *
+ */
+void visionManagerSetCaptureGovernor(int every, int intervalMilliseconds, int governed);
+
+/** @brief Sets how PRU1 stores the captured pixels
+ *
+ *	CAPTURE_FORMAT_RGB (3 bytes a pixel) needs the camera in its GRB 4:2:2 mode;
+ *	CAPTURE_FORMAT_UYVY (2) and CAPTURE_FORMAT_Y8 (luma only, 1) need it in YUV 4:2:2.
+ *	UYVY frames are converted to BGR as they come out of the carveout. Y8 frames are
+ *	processed as single channel: the threshold mode works on brightness (its bounds are
+ *	the first of the configured ones) and the motion gate on the luma directly; only
+ *	the networks see them expanded to BGR. Must be called before
+ *	visionManagerInitialize.
+ *
+ *	@param	format one of the CAPTURE_FORMAT_ values.
+ * 	@return void.
+ *
+ */
+void visionManagerSetCaptureFormat(int format);
+
+/** @brief Runs without any windows
+ *
+ *	No HighGUI window is created and nothing is drawn on the frames, so no window system
+ *	is needed. Pressing 'p' (see commandInput.h for how commands arrive headless) draws
+ *	the annotations on the next processed frame as usual and writes it to a numbered
+ *	PNG file instead. Must be called before visionManagerInitialize.
+ *
+ *	@param	enable non-zero to run headless.
+ *	@param	prefix the path prefix for dumped frames, or NULL for the default.
+ * 	@return void.
+ *
+ */
+void visionManagerSetHeadless(int enable, const char *prefix);
+
+/** @brief Waits until PRU1 has a frame ready, or the timeout passes
+ *
+ *	Used to pace the headless loop on frame arrival rather than a fixed delay. The ready
+ *	flag is polled every VISION_FRAME_POLL_MICROSECONDS.
+ *
+ *	@param	timeoutMilliseconds the longest to wait.
+ * 	@return 1 if a frame is ready, 0 on timeout.
+ *
+ */
+int visionManagerWaitForFrame(int timeoutMilliseconds);
+
+/** @brief Sets how the networks are loaded
+ *
+ *	The networks are not loaded by visionManagerInitialize, but the first time their
+ *	mode is selected. By default that happens right away, stalling the loop for the
+ *	few seconds it takes; in the background the loop keeps displaying frames instead
+ *	until the network (and its warm-up pass) is ready. With a memory budget, loading
+ *	one network unloads the other if both together would be over the budget. Must be
+ *	called before visionManagerInitialize.
+ *
+ *	@param	background non-zero to load networks on a background thread.
+ *	@param	memoryBudgetMegabytes how much memory the two networks may use together,
+ *			or 0 for no limit.
+ * 	@return void.
+ *
+ */
+void visionManagerSetModelLoading(int background, long memoryBudgetMegabytes);
+
+/** @brief Benchmarks the networks and persists the fastest acceptable setup
+ *
+ *	Runs every backend/target/input resolution combination OpenCV will accept for each
+ *	network over a set of frames, reporting latency and how well the detections agree
+ *	with the reference setup, then switches to and saves the fastest combination that
+ *	agrees well enough. Must be called after visionManagerInitialize.
+ *
+ *	@param	framesDirectory a directory of recorded frames, or NULL to grab frames live
+ *			from the PRU.
+ *	@param	configFile where to save the chosen configuration.
+ * 	@return 0 on success, -1 if there were no frames or the file couldn't be written.
+ *
+ */
+int visionManagerAutotune(const char *framesDirectory, const char *configFile);
+
 /** @brief Uninitializes the image/vision subsystem
  *
  *	This just garbage collects the image header for the main image, the entire image
@@ -70,8 +391,9 @@ void visionManagerUninitialize();
  * 	This mask is then run through cvMoments to find matching areas larger than an
  * 	arbitrary size, calculate the center position of the area, and draw an indicator
  * 	on the image at that point, with a text representation of the coordinates. We then
- * 	update the windows to display these images, and set the flag to let the PRU know
- * 	we are ready to consume another frame.
+ * 	update the windows to display these images. The frame is copied into a frame pool
+ * 	buffer and the flag set to let the PRU know it can capture another frame before any
+ * 	of that processing starts.
  *
  * 	@return void.
  *
@@ -90,6 +412,8 @@ void visionManagerInitializeDarknet();
 
 void visionManagerProcessNone();
 
+void visionManagerProcessLoading(const char *modelName);
+
 void visionManagerProcessThreshold();
 
 void visionManagerCaptureThreshold();
@@ -98,6 +422,8 @@ void visionManagerProcessCaffe();
 
 void visionManagerProcessDarknet();
 
+void visionManagerProcessScheduled();
+
 #endif
 
 
@@ -0,0 +1,107 @@
+/** @file visionMotion.cpp
+ *  @brief Functions for gating inference on scene changes.
+ *
+ *  A 320x240 frame becomes a 40x30 luma image, sampled at every other pixel of every
+ *  other row of each block, so the whole test reads about a sixteenth of the frame and
+ *  touches no floating point. The background is kept in 8.8 fixed point and moves an
+ *  eighth of the way towards each new frame.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdlib.h>
+#include "visionMotion.hpp"
+
+using namespace cv;
+
+#define MOTION_SAMPLE_STEP				2
+#define MOTION_FIXED_SHIFT				8
+
+void visionMotionInitialize(VISION_MOTION *motion, Size frameSize, int threshold, int maxSkip)
+{
+	motion->size = Size(frameSize.width / VISION_MOTION_BLOCK_SIZE, frameSize.height / VISION_MOTION_BLOCK_SIZE);
+	motion->threshold = threshold;
+	motion->maxSkip = maxSkip;
+	motion->luma.assign(motion->size.area(), 0);
+	motion->background.assign(motion->size.area(), 0);
+	motion->inferred = 0;
+	motion->skipped = 0;
+	visionMotionReset(motion);
+}
+
+void visionMotionReset(VISION_MOTION *motion)
+{
+	motion->primed = false;
+	motion->framesSinceInference = 0;
+}
+
+static void visionMotionLuma(VISION_MOTION *motion, const Mat &frame)
+{
+	const int samples = (VISION_MOTION_BLOCK_SIZE / MOTION_SAMPLE_STEP) * (VISION_MOTION_BLOCK_SIZE / MOTION_SAMPLE_STEP);
+	const int channels = frame.channels();
+	uint8_t *luma = &(motion->luma[0]);
+
+	for(int blockRow = 0; blockRow < motion->size.height; blockRow++)
+	{
+		for(int blockColumn = 0; blockColumn < motion->size.width; blockColumn++)
+		{
+			int sum = 0;
+			for(int row = 0; row < VISION_MOTION_BLOCK_SIZE; row += MOTION_SAMPLE_STEP)
+			{
+				const uint8_t *pixel = frame.ptr<uint8_t>(blockRow * VISION_MOTION_BLOCK_SIZE + row) + blockColumn * VISION_MOTION_BLOCK_SIZE * channels;
+				for(int column = 0; column < VISION_MOTION_BLOCK_SIZE; column += MOTION_SAMPLE_STEP, pixel += MOTION_SAMPLE_STEP * channels)
+				{
+					/* BT.601 luma from BGR, weights out of 256, or the luma itself from a Y8 frame. */
+					sum += (channels == 1) ? pixel[0] : (29 * pixel[0] + 150 * pixel[1] + 77 * pixel[2]) >> 8;
+				}
+			}
+			*(luma++) = sum / samples;
+		}
+	}
+}
+
+bool visionMotionShouldInfer(VISION_MOTION *motion, const Mat &frame)
+{
+	const int blocks = motion->size.area();
+	int changed = 0;
+
+	if(motion->threshold <= 0 || blocks == 0)
+	{
+		motion->inferred++;
+		return true;
+	}
+
+	visionMotionLuma(motion, frame);
+
+	for(int i = 0; i < blocks; i++)
+	{
+		const int current = motion->luma[i] << MOTION_FIXED_SHIFT;
+		int &background = motion->background[i];
+
+		if(!motion->primed)
+		{
+			background = current;
+			continue;
+		}
+		if(abs(current - background) > (motion->threshold << MOTION_FIXED_SHIFT)) changed++;
+		background += (current - background) >> VISION_MOTION_BACKGROUND_SHIFT;
+	}
+
+	if(!motion->primed ||
+		changed * 100 >= blocks * VISION_MOTION_MIN_CHANGED_PERCENT ||
+		motion->framesSinceInference >= motion->maxSkip)
+	{
+		motion->primed = true;
+		motion->framesSinceInference = 0;
+		motion->inferred++;
+		return true;
+	}
+
+	motion->framesSinceInference++;
+	motion->skipped++;
+	return false;
+}
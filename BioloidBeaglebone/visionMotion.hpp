@@ -0,0 +1,81 @@
+/** @file visionMotion.hpp
+ *  @brief Function prototypes for gating inference on scene changes.
+ *
+ *  These are the prototypes for functions that keep a heavily downsampled luma image
+ *  of the scene and a slowly adapting background of it, and decide each frame whether
+ *  enough has changed since the background to be worth running a network on. When the
+ *  robot is standing still looking at the same thing, most frames aren't, and the last
+ *  detections can be reused instead. A forward pass is still forced every so often so
+ *  a change too slow or too small to trip the gate can't hide forever.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONMOTION_HPP_
+#define VISIONMOTION_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "opencv2/core.hpp"
+
+#define VISION_MOTION_BLOCK_SIZE			8
+#define VISION_MOTION_DEFAULT_THRESHOLD		12
+#define VISION_MOTION_DEFAULT_MAX_SKIP		15
+#define VISION_MOTION_BACKGROUND_SHIFT		3
+#define VISION_MOTION_MIN_CHANGED_PERCENT	1
+
+typedef struct{
+	cv::Size size;
+	int threshold;
+	int maxSkip;
+	bool primed;
+	int framesSinceInference;
+	std::vector<uint8_t> luma;
+	std::vector<int> background;
+	uint64_t inferred;
+	uint64_t skipped;
+} VISION_MOTION;
+
+/** @brief Sets up a motion gate for frames of a given size
+ *
+ *	@param	motion the gate to initialize.
+ *	@param	frameSize the size of the frames that will be passed in.
+ *	@param	threshold how many luma levels a block has to move away from the background
+ *			to count as changed. Lower is more sensitive; 0 disables the gate.
+ *	@param	maxSkip the most frames in a row that may be skipped.
+ * 	@return void.
+ *
+ */
+void visionMotionInitialize(VISION_MOTION *motion, cv::Size frameSize, int threshold, int maxSkip);
+
+/** @brief Forgets the background so the next frame is always inferred
+ *
+ * 	Used when the mode changes, since the last detections then belong to another network.
+ *
+ *	@param	motion the gate.
+ * 	@return void.
+ *
+ */
+void visionMotionReset(VISION_MOTION *motion);
+
+/** @brief Decides whether to run the network on a frame
+ *
+ * 	Reduces the frame to one luma value per VISION_MOTION_BLOCK_SIZE square block (from
+ * 	a sparse sample of the block, in integer arithmetic), counts the blocks that differ
+ * 	from the background by more than the threshold, and folds the frame into the
+ * 	background. The frame is inferred if at least VISION_MOTION_MIN_CHANGED_PERCENT of
+ * 	the blocks changed, if the gate hasn't seen a frame yet, or if maxSkip frames in a
+ * 	row have been skipped. The inferred and skipped counters are updated.
+ *
+ *	@param	motion the gate.
+ *	@param	frame the 8 bit BGR frame, or a single channel luma (Y8) frame.
+ * 	@return true to run the network, false to reuse the last detections.
+ *
+ */
+bool visionMotionShouldInfer(VISION_MOTION *motion, const cv::Mat &frame);
+
+#endif /* VISIONMOTION_HPP_ */
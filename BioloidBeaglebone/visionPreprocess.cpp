@@ -0,0 +1,371 @@
+/** @file visionPreprocess.cpp
+ *  @brief Functions for turning a camera frame into a network input blob.
+ *
+ *  Before a network sees a frame, blobFromImage used to resize it, split the interleaved
+ *  BGR pixels into planes and normalize them, each in its own pass, into a freshly
+ *  allocated blob. Here we do all of it in one pass, reading the frame in whatever
+ *  order undoes the way it was stored, into a blob that lives as long as the plan does.
+ *  The resize is a fixed point bilinear filter driven by tables built once in
+ *  visionPreprocessInitialize.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include "opencv2/imgproc.hpp"
+#include "visionPreprocess.hpp"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VISION_PREPROCESS_NEON
+#endif
+
+using namespace cv;
+
+static void visionPreprocessBuildAxis(int inputLength,
+										int outputLength,
+										bool reverse,
+										int stride,
+										std::vector<int> &index0,
+										std::vector<int> &index1,
+										std::vector<int> &weight)
+{
+	index0.resize(outputLength);
+	index1.resize(outputLength);
+	weight.resize(outputLength);
+
+	float ratio = (float)inputLength / (float)outputLength;
+	for(int position = 0; position < outputLength; position++)
+	{
+		float source = (position + 0.5f) * ratio - 0.5f;
+		if(source < 0) source = 0;
+		int first = (int)source;
+		if(first > inputLength - 1) first = inputLength - 1;
+		int second = (first < inputLength - 1) ? first + 1 : first;
+		int fraction = (int)((source - first) * VISION_PREPROCESS_WEIGHT_ONE + 0.5f);
+
+		if(reverse)
+		{
+			first = inputLength - 1 - first;
+			second = inputLength - 1 - second;
+		}
+		index0[position] = first * stride;
+		index1[position] = second * stride;
+		weight[position] = fraction;
+	}
+}
+
+void visionPreprocessInitialize(VISION_PREPROCESS *plan,
+								Size inputSize,
+								Size blobSize,
+								float scale,
+								float mean,
+								bool swapRB,
+								VISION_PREPROCESS_ORIENTATION orientation)
+{
+	plan->inputSize = inputSize;
+	plan->blobSize = blobSize;
+	plan->scale = scale;
+	plan->mean = mean;
+	plan->swapRB = swapRB;
+	plan->orientation = orientation;
+	plan->resizing = (inputSize != blobSize);
+
+	for(int value = 0; value < 256; value++)
+	{
+		plan->lookup[value] = ((float)value - mean) * scale;
+	}
+
+	bool reverseRows = (orientation == VISION_PREPROCESS_ROTATE_180 || orientation == VISION_PREPROCESS_FLIP);
+	bool reverseColumns = (orientation == VISION_PREPROCESS_ROTATE_180 || orientation == VISION_PREPROCESS_MIRROR);
+	visionPreprocessBuildAxis(inputSize.height, blobSize.height, reverseRows, 1,
+								plan->rowIndex0, plan->rowIndex1, plan->rowWeight);
+	visionPreprocessBuildAxis(inputSize.width, blobSize.width, reverseColumns, 3,
+								plan->columnOffset0, plan->columnOffset1, plan->columnWeight);
+
+	int blobShape[4] = {1, 3, blobSize.height, blobSize.width};
+	plan->blob.create(4, blobShape, CV_32F);
+}
+
+#ifndef VISION_PREPROCESS_NEON
+static void visionPreprocessRunResize(const VISION_PREPROCESS *plan, const Mat &image, float *first, float *second, float *third)
+{
+	const int rounding = 1 << (2 * VISION_PREPROCESS_WEIGHT_BITS - 1);
+
+	for(int row = 0; row < plan->blobSize.height; row++)
+	{
+		const unsigned char *top = image.ptr<unsigned char>(plan->rowIndex0[row]);
+		const unsigned char *bottom = image.ptr<unsigned char>(plan->rowIndex1[row]);
+		const unsigned int bottomWeight = plan->rowWeight[row];
+		const unsigned int topWeight = VISION_PREPROCESS_WEIGHT_ONE - bottomWeight;
+
+		for(int column = 0; column < plan->blobSize.width; column++)
+		{
+			const int left = plan->columnOffset0[column];
+			const int right = plan->columnOffset1[column];
+			const unsigned int rightWeight = plan->columnWeight[column];
+			const unsigned int leftWeight = VISION_PREPROCESS_WEIGHT_ONE - rightWeight;
+
+			for(int channel = 0; channel < 3; channel++)
+			{
+				unsigned int upper = top[left + channel] * leftWeight + top[right + channel] * rightWeight;
+				unsigned int lower = bottom[left + channel] * leftWeight + bottom[right + channel] * rightWeight;
+				unsigned int value = (upper * topWeight + lower * bottomWeight + rounding) >> (2 * VISION_PREPROCESS_WEIGHT_BITS);
+				float *plane = (channel == 0) ? first : ((channel == 1) ? second : third);
+				plane[column] = plan->lookup[value];
+			}
+		}
+		first += plan->blobSize.width;
+		second += plan->blobSize.width;
+		third += plan->blobSize.width;
+	}
+}
+
+static void visionPreprocessRunDirect(const VISION_PREPROCESS *plan, const Mat &image, float *first, float *second, float *third)
+{
+	for(int row = 0; row < plan->blobSize.height; row++)
+	{
+		const unsigned char *source = image.ptr<unsigned char>(plan->rowIndex0[row]);
+		for(int column = 0; column < plan->blobSize.width; column++)
+		{
+			const unsigned char *pixel = source + plan->columnOffset0[column];
+			*first++ = plan->lookup[pixel[0]];
+			*second++ = plan->lookup[pixel[1]];
+			*third++ = plan->lookup[pixel[2]];
+		}
+	}
+}
+#else
+static inline void visionPreprocessNEONStore(float *destination, uint8x16_t pixels, float32x4_t scale, float32x4_t bias)
+{
+	uint16x8_t low = vmovl_u8(vget_low_u8(pixels));
+	uint16x8_t high = vmovl_u8(vget_high_u8(pixels));
+	vst1q_f32(destination, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_low_u16(low))), scale));
+	vst1q_f32(destination + 4, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_high_u16(low))), scale));
+	vst1q_f32(destination + 8, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_low_u16(high))), scale));
+	vst1q_f32(destination + 12, vmlaq_f32(bias, vcvtq_f32_u32(vmovl_u16(vget_high_u16(high))), scale));
+}
+
+static inline uint8x16_t visionPreprocessNEONReverse(uint8x16_t pixels)
+{
+	uint8x16_t reversed = vrev64q_u8(pixels);
+	return vcombine_u8(vget_high_u8(reversed), vget_low_u8(reversed));
+}
+
+static void visionPreprocessRunDirectNEON(const VISION_PREPROCESS *plan, const Mat &image, float *first, float *second, float *third)
+{
+	const float32x4_t scale = vdupq_n_f32(plan->scale);
+	const float32x4_t bias = vdupq_n_f32(-plan->mean * plan->scale);
+	const bool reverse = (plan->orientation == VISION_PREPROCESS_ROTATE_180 || plan->orientation == VISION_PREPROCESS_MIRROR);
+	const int width = plan->blobSize.width;
+	const int vectorWidth = width & ~15;
+
+	for(int row = 0; row < plan->blobSize.height; row++)
+	{
+		const unsigned char *source = image.ptr<unsigned char>(plan->rowIndex0[row]);
+		int column = 0;
+		for(; column < vectorWidth; column += 16)
+		{
+			uint8x16x3_t pixels;
+			if(reverse)
+			{
+				pixels = vld3q_u8(source + (width - column - 16) * 3);
+				pixels.val[0] = visionPreprocessNEONReverse(pixels.val[0]);
+				pixels.val[1] = visionPreprocessNEONReverse(pixels.val[1]);
+				pixels.val[2] = visionPreprocessNEONReverse(pixels.val[2]);
+			}
+			else
+			{
+				pixels = vld3q_u8(source + column * 3);
+			}
+			visionPreprocessNEONStore(first + column, pixels.val[0], scale, bias);
+			visionPreprocessNEONStore(second + column, pixels.val[1], scale, bias);
+			visionPreprocessNEONStore(third + column, pixels.val[2], scale, bias);
+		}
+		for(; column < width; column++)
+		{
+			const unsigned char *pixel = source + plan->columnOffset0[column];
+			first[column] = plan->lookup[pixel[0]];
+			second[column] = plan->lookup[pixel[1]];
+			third[column] = plan->lookup[pixel[2]];
+		}
+		first += width;
+		second += width;
+		third += width;
+	}
+}
+/*
+ * vld3_lane_u8 pulls one interleaved BGR pixel apart into the same lane of three
+ * vectors, so the column gather for eight output pixels is eight loads rather than
+ * twenty four.
+ */
+static inline uint8x8x3_t visionPreprocessNEONGather(const unsigned char *row, const int *offsets)
+{
+	uint8x8x3_t pixels;
+	pixels.val[0] = pixels.val[1] = pixels.val[2] = vdup_n_u8(0);
+	pixels = vld3_lane_u8(row + offsets[0], pixels, 0);
+	pixels = vld3_lane_u8(row + offsets[1], pixels, 1);
+	pixels = vld3_lane_u8(row + offsets[2], pixels, 2);
+	pixels = vld3_lane_u8(row + offsets[3], pixels, 3);
+	pixels = vld3_lane_u8(row + offsets[4], pixels, 4);
+	pixels = vld3_lane_u8(row + offsets[5], pixels, 5);
+	pixels = vld3_lane_u8(row + offsets[6], pixels, 6);
+	pixels = vld3_lane_u8(row + offsets[7], pixels, 7);
+	return pixels;
+}
+
+static inline float32x4_t visionPreprocessNEONBilinear(uint16x4_t topLeft,
+														uint16x4_t topRight,
+														uint16x4_t bottomLeft,
+														uint16x4_t bottomRight,
+														uint16x4_t leftWeight,
+														uint16x4_t rightWeight,
+														uint32_t topWeight,
+														uint32_t bottomWeight,
+														float32x4_t scale,
+														float32x4_t bias)
+{
+	uint32x4_t upper = vmlal_u16(vmull_u16(topLeft, leftWeight), topRight, rightWeight);
+	uint32x4_t lower = vmlal_u16(vmull_u16(bottomLeft, leftWeight), bottomRight, rightWeight);
+	uint32x4_t value = vmlaq_n_u32(vmulq_n_u32(upper, topWeight), lower, bottomWeight);
+	value = vrshrq_n_u32(value, 2 * VISION_PREPROCESS_WEIGHT_BITS);
+	return vmlaq_f32(bias, vcvtq_f32_u32(value), scale);
+}
+
+static inline void visionPreprocessNEONResizeStore(float *destination,
+													uint8x8_t topLeft,
+													uint8x8_t topRight,
+													uint8x8_t bottomLeft,
+													uint8x8_t bottomRight,
+													uint16x8_t leftWeight,
+													uint16x8_t rightWeight,
+													uint32_t topWeight,
+													uint32_t bottomWeight,
+													float32x4_t scale,
+													float32x4_t bias)
+{
+	uint16x8_t upperLeft = vmovl_u8(topLeft);
+	uint16x8_t upperRight = vmovl_u8(topRight);
+	uint16x8_t lowerLeft = vmovl_u8(bottomLeft);
+	uint16x8_t lowerRight = vmovl_u8(bottomRight);
+	vst1q_f32(destination, visionPreprocessNEONBilinear(vget_low_u16(upperLeft), vget_low_u16(upperRight),
+														vget_low_u16(lowerLeft), vget_low_u16(lowerRight),
+														vget_low_u16(leftWeight), vget_low_u16(rightWeight),
+														topWeight, bottomWeight, scale, bias));
+	vst1q_f32(destination + 4, visionPreprocessNEONBilinear(vget_high_u16(upperLeft), vget_high_u16(upperRight),
+														vget_high_u16(lowerLeft), vget_high_u16(lowerRight),
+														vget_high_u16(leftWeight), vget_high_u16(rightWeight),
+														topWeight, bottomWeight, scale, bias));
+}
+
+/*
+ * The same fixed point filter as visionPreprocessRunResize, eight output columns at a
+ * time. The sums and the rounding shift match the scalar path exactly; only the final
+ * scale and mean are applied as a multiply-add instead of through the lookup table.
+ */
+static void visionPreprocessRunResizeNEON(const VISION_PREPROCESS *plan, const Mat &image, float *first, float *second, float *third)
+{
+	const float32x4_t scale = vdupq_n_f32(plan->scale);
+	const float32x4_t bias = vdupq_n_f32(-plan->mean * plan->scale);
+	const uint16x8_t one = vdupq_n_u16(VISION_PREPROCESS_WEIGHT_ONE);
+	const int rounding = 1 << (2 * VISION_PREPROCESS_WEIGHT_BITS - 1);
+	const int width = plan->blobSize.width;
+	const int vectorWidth = width & ~7;
+	const int *leftOffsets = &plan->columnOffset0[0];
+	const int *rightOffsets = &plan->columnOffset1[0];
+	const int *weights = &plan->columnWeight[0];
+
+	for(int row = 0; row < plan->blobSize.height; row++)
+	{
+		const unsigned char *top = image.ptr<unsigned char>(plan->rowIndex0[row]);
+		const unsigned char *bottom = image.ptr<unsigned char>(plan->rowIndex1[row]);
+		const unsigned int bottomWeight = plan->rowWeight[row];
+		const unsigned int topWeight = VISION_PREPROCESS_WEIGHT_ONE - bottomWeight;
+
+		int column = 0;
+		for(; column < vectorWidth; column += 8)
+		{
+			uint16x8_t rightWeight = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(weights + column))),
+													vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(weights + column + 4))));
+			uint16x8_t leftWeight = vsubq_u16(one, rightWeight);
+			uint8x8x3_t topLeft = visionPreprocessNEONGather(top, leftOffsets + column);
+			uint8x8x3_t topRight = visionPreprocessNEONGather(top, rightOffsets + column);
+			uint8x8x3_t bottomLeft = visionPreprocessNEONGather(bottom, leftOffsets + column);
+			uint8x8x3_t bottomRight = visionPreprocessNEONGather(bottom, rightOffsets + column);
+
+			visionPreprocessNEONResizeStore(first + column, topLeft.val[0], topRight.val[0], bottomLeft.val[0], bottomRight.val[0],
+											leftWeight, rightWeight, topWeight, bottomWeight, scale, bias);
+			visionPreprocessNEONResizeStore(second + column, topLeft.val[1], topRight.val[1], bottomLeft.val[1], bottomRight.val[1],
+											leftWeight, rightWeight, topWeight, bottomWeight, scale, bias);
+			visionPreprocessNEONResizeStore(third + column, topLeft.val[2], topRight.val[2], bottomLeft.val[2], bottomRight.val[2],
+											leftWeight, rightWeight, topWeight, bottomWeight, scale, bias);
+		}
+		for(; column < width; column++)
+		{
+			const int left = leftOffsets[column];
+			const int right = rightOffsets[column];
+			const unsigned int rightWeight = weights[column];
+			const unsigned int leftWeight = VISION_PREPROCESS_WEIGHT_ONE - rightWeight;
+			float *planes[3] = {first, second, third};
+
+			for(int channel = 0; channel < 3; channel++)
+			{
+				unsigned int upper = top[left + channel] * leftWeight + top[right + channel] * rightWeight;
+				unsigned int lower = bottom[left + channel] * leftWeight + bottom[right + channel] * rightWeight;
+				unsigned int value = (upper * topWeight + lower * bottomWeight + rounding) >> (2 * VISION_PREPROCESS_WEIGHT_BITS);
+				planes[channel][column] = plan->lookup[value];
+			}
+		}
+		first += width;
+		second += width;
+		third += width;
+	}
+}
+#endif
+
+const Mat &visionPreprocessRun(VISION_PREPROCESS *plan, const Mat &image)
+{
+	const Mat *source = &image;
+	if(image.size() != plan->inputSize)
+	{
+		resize(image, plan->scratch, plan->inputSize, 0, 0, INTER_LINEAR);
+		source = &plan->scratch;
+	}
+
+	const int planeSize = plan->blobSize.area();
+	float *first = (float *)plan->blob.data;
+	float *second = first + planeSize;
+	float *third = second + planeSize;
+	if(plan->swapRB)
+	{
+		float *swap = first;
+		first = third;
+		third = swap;
+	}
+
+#ifdef VISION_PREPROCESS_NEON
+	if(plan->resizing) visionPreprocessRunResizeNEON(plan, *source, first, second, third);
+	else visionPreprocessRunDirectNEON(plan, *source, first, second, third);
+#else
+	if(plan->resizing) visionPreprocessRunResize(plan, *source, first, second, third);
+	else visionPreprocessRunDirect(plan, *source, first, second, third);
+#endif
+	return plan->blob;
+}
+
+Rect visionPreprocessToFrame(const VISION_PREPROCESS *plan, const Rect &box, Size frameSize)
+{
+	Rect mapped = box;
+	if(plan->orientation == VISION_PREPROCESS_ROTATE_180 || plan->orientation == VISION_PREPROCESS_MIRROR)
+	{
+		mapped.x = frameSize.width - box.x - box.width;
+	}
+	if(plan->orientation == VISION_PREPROCESS_ROTATE_180 || plan->orientation == VISION_PREPROCESS_FLIP)
+	{
+		mapped.y = frameSize.height - box.y - box.height;
+	}
+	return mapped;
+}
@@ -0,0 +1,117 @@
+/** @file visionPreprocess.hpp
+ *  @brief Function prototypes for turning a camera frame into a network input blob.
+ *
+ *  These are the prototypes for functions that set up a preprocessing plan for a
+ *  network once, at initialization, and then use it every frame to write the resized,
+ *  reoriented, scaled, mean subtracted, planar (NCHW) input straight from the frame the
+ *  PRU wrote into a blob that was allocated along with the plan. This replaces
+ *  cv::dnn::blobFromImage, which allocates a new blob and makes a separate pass over
+ *  the image for each of its steps on every frame.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONPREPROCESS_HPP_
+#define VISIONPREPROCESS_HPP_
+
+#include <vector>
+#include "opencv2/core.hpp"
+
+#define VISION_PREPROCESS_WEIGHT_BITS		11
+#define VISION_PREPROCESS_WEIGHT_ONE		(1 << VISION_PREPROCESS_WEIGHT_BITS)
+
+/*
+ * The networks have always been handed RGB planes: blobFromImage's swapRB defaulted
+ * to true in OpenCV 3.4, which the calls the plans replaced relied on.
+ */
+#define VISION_PREPROCESS_NETWORK_SWAP_RB	true
+
+typedef enum{
+	VISION_PREPROCESS_KEEP,
+	VISION_PREPROCESS_ROTATE_180,
+	VISION_PREPROCESS_MIRROR,
+	VISION_PREPROCESS_FLIP
+} VISION_PREPROCESS_ORIENTATION;
+
+typedef struct{
+	cv::Size inputSize;
+	cv::Size blobSize;
+	float scale;
+	float mean;
+	bool swapRB;
+	VISION_PREPROCESS_ORIENTATION orientation;
+	bool resizing;
+	float lookup[256];
+	std::vector<int> rowIndex0;
+	std::vector<int> rowIndex1;
+	std::vector<int> rowWeight;
+	std::vector<int> columnOffset0;
+	std::vector<int> columnOffset1;
+	std::vector<int> columnWeight;
+	cv::Mat scratch;
+	cv::Mat blob;
+} VISION_PREPROCESS;
+
+/** @brief Sets up a preprocessing plan and allocates its blob.
+ *
+ * 	The per channel arithmetic ((pixel - mean) * scale) only ever sees 256 distinct
+ * 	inputs, so it is folded into a lookup table here rather than done per pixel. The
+ * 	source rows, source byte offsets and fixed point bilinear weights for every output
+ * 	row and column are worked out here too, with the orientation correction already
+ * 	applied to them, so the per frame pass is nothing but table lookups and integer
+ * 	multiply/adds.
+ *
+ *	@param	plan the plan to initialize.
+ *	@param	inputSize the size of the frames that will be passed to visionPreprocessRun.
+ *	@param	blobSize the spatial size of the network input.
+ *	@param	scale the factor applied after mean subtraction.
+ *	@param	mean the value subtracted from every channel.
+ *	@param	swapRB true to hand the network RGB planes instead of BGR.
+ *	@param	orientation the correction to apply to the frame as it is read.
+ * 	@return void.
+ *
+ */
+void visionPreprocessInitialize(VISION_PREPROCESS *plan,
+								cv::Size inputSize,
+								cv::Size blobSize,
+								float scale,
+								float mean,
+								bool swapRB,
+								VISION_PREPROCESS_ORIENTATION orientation = VISION_PREPROCESS_KEEP);
+
+/** @brief Fills the plan's blob from a BGR frame.
+ *
+ * 	Does the reorientation, resize, channel split, reorder and normalization in one pass
+ * 	over the frame. On ARM builds with NEON the resize is done 8 output pixels at a
+ * 	time, and when the frame and blob are the same size the resize drops out and the
+ * 	float conversion is done 16 pixels at a time. If the frame does not match the size
+ * 	the plan was built for, it is first resized into a scratch image so the result is
+ * 	still correct, just not as cheap.
+ *
+ *	@param	plan an initialized plan.
+ *	@param	image the 8 bit, 3 channel frame, typically the Mat over the PRU carveout.
+ * 	@return the plan's blob, ready for Net::setInput.
+ *
+ */
+const cv::Mat &visionPreprocessRun(VISION_PREPROCESS *plan, const cv::Mat &image);
+
+/** @brief Maps a box found in the network's view back onto the stored frame.
+ *
+ * 	Boxes decoded from a network fed by this plan are in the corrected orientation (but
+ * 	already scaled to the frame size). This undoes the orientation correction so they
+ * 	can be drawn on, or compared with, the frame as the PRU stored it.
+ *
+ *	@param	plan the plan that produced the network input.
+ *	@param	box a box in corrected orientation, in frame pixels.
+ *	@param	frameSize the size of the frame handed to visionPreprocessRun, which the
+ *			boxes were decoded in; not necessarily the plan's input size.
+ * 	@return the same box in the stored frame's orientation.
+ *
+ */
+cv::Rect visionPreprocessToFrame(const VISION_PREPROCESS *plan, const cv::Rect &box, cv::Size frameSize);
+
+#endif /* VISIONPREPROCESS_HPP_ */
@@ -0,0 +1,66 @@
+/** @file visionPyramid.cpp
+ *  @brief Functions for keeping reduced copies of the current frame.
+ *
+ *  Each level is the area average of the one above it (resize with INTER_AREA, which
+ *  for an exact halving averages each 2x2 block), which is cheaper than pyrDown's
+ *  5x5 Gaussian and plenty for thresholding and display.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include "opencv2/imgproc.hpp"
+#include "visionPyramid.hpp"
+
+using namespace cv;
+
+void visionPyramidInitialize(VISION_PYRAMID *pyramid, Size frameSize, int type)
+{
+	pyramid->frameSize = frameSize;
+	pyramid->count = 1;
+	pyramid->made[0] = false;
+	pyramid->reductions = 0;
+	for(Size size = frameSize / 2; pyramid->count < VISION_PYRAMID_MAX_LEVELS && size.width >= VISION_PYRAMID_MIN_COLUMNS; size = size / 2)
+	{
+		pyramid->levels[pyramid->count].create(size, type);
+		pyramid->made[pyramid->count] = false;
+		pyramid->count++;
+	}
+}
+
+void visionPyramidSetFrame(VISION_PYRAMID *pyramid, const Mat &frame)
+{
+	pyramid->levels[0] = frame;
+	pyramid->made[0] = true;
+	for(int level = 1; level < pyramid->count; level++) pyramid->made[level] = false;
+}
+
+int visionPyramidLevelFor(const VISION_PYRAMID *pyramid, Size maximum)
+{
+	int level = 0;
+	for(Size size = pyramid->frameSize; level < pyramid->count - 1 && (size.width > maximum.width || size.height > maximum.height); size = size / 2)
+	{
+		level++;
+	}
+	return level;
+}
+
+const Mat &visionPyramidLevel(VISION_PYRAMID *pyramid, int level)
+{
+	level = std::min(std::max(level, 0), pyramid->count - 1);
+	if(!pyramid->made[level])
+	{
+		resize(visionPyramidLevel(pyramid, level - 1), pyramid->levels[level], pyramid->levels[level].size(), 0, 0, INTER_AREA);
+		pyramid->made[level] = true;
+		pyramid->reductions++;
+	}
+	return pyramid->levels[level];
+}
+
+int visionPyramidScale(int level)
+{
+	return 1 << level;
+}
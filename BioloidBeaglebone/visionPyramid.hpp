@@ -0,0 +1,86 @@
+/** @file visionPyramid.hpp
+ *  @brief Function prototypes for keeping reduced copies of the current frame.
+ *
+ *  These are the prototypes for functions that keep an image pyramid of the current
+ *  frame: level 0 is the frame itself and each level after it is half the size of the
+ *  one before, each way. A level is only made the first time something asks for it
+ *  after a new frame is set, and then kept for anything else that asks, so a frame
+ *  costs at most one reduction per level however many consumers read it. Consumers
+ *  that only need a small image (thresholding and display) ask for the level that
+ *  fits a size; ones that need the detail (a network looking for distant objects)
+ *  read level 0. Levels are made from the frame as it is when first asked for, so ask
+ *  before drawing on the frame.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONPYRAMID_HPP_
+#define VISIONPYRAMID_HPP_
+
+#include <stdint.h>
+#include "opencv2/core.hpp"
+
+#define VISION_PYRAMID_MAX_LEVELS		4
+#define VISION_PYRAMID_MIN_COLUMNS		80
+
+typedef struct{
+	cv::Size frameSize;
+	int count;
+	cv::Mat levels[VISION_PYRAMID_MAX_LEVELS];
+	bool made[VISION_PYRAMID_MAX_LEVELS];
+	uint64_t reductions;
+} VISION_PYRAMID;
+
+/** @brief Sets up a pyramid for frames of a given size and type
+ *
+ * 	Allocates every level below the frame once, halving until a level would be
+ * 	narrower than VISION_PYRAMID_MIN_COLUMNS or the levels run out.
+ *
+ *	@param	pyramid the pyramid to initialize.
+ *	@param	frameSize the size of the frames.
+ *	@param	type the frames' OpenCV type.
+ * 	@return void.
+ *
+ */
+void visionPyramidInitialize(VISION_PYRAMID *pyramid, cv::Size frameSize, int type);
+
+/** @brief Makes a new frame level 0 and forgets the levels made from the last one
+ *
+ *	@param	pyramid the pyramid.
+ *	@param	frame the frame; it is referred to, not copied.
+ * 	@return void.
+ *
+ */
+void visionPyramidSetFrame(VISION_PYRAMID *pyramid, const cv::Mat &frame);
+
+/** @brief Picks the largest level no bigger than a size
+ *
+ *	@param	pyramid the pyramid.
+ *	@param	maximum the largest size wanted.
+ * 	@return the level, or the smallest there is if none fit.
+ *
+ */
+int visionPyramidLevelFor(const VISION_PYRAMID *pyramid, cv::Size maximum);
+
+/** @brief Gets a level of the current frame, making it (and any above it) if need be
+ *
+ *	@param	pyramid the pyramid.
+ *	@param	level the level, 0 for the frame itself.
+ * 	@return the level's image.
+ *
+ */
+const cv::Mat &visionPyramidLevel(VISION_PYRAMID *pyramid, int level);
+
+/** @brief Gets how many frame pixels a level's pixel covers, each way
+ *
+ *	@param	level the level.
+ * 	@return 2 to the power of level.
+ *
+ */
+int visionPyramidScale(int level);
+
+#endif /* VISIONPYRAMID_HPP_ */
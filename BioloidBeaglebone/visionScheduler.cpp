@@ -0,0 +1,98 @@
+/** @file visionScheduler.cpp
+ *  @brief Functions for choosing what processing runs on each frame.
+ *
+ *  Latencies are exponentially weighted moving averages, seeded with the first
+ *  measurement, so a zero latency means the task hasn't been measured yet.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include "visionScheduler.hpp"
+
+using namespace std;
+
+static const char *visionSchedulerTaskNames[VISION_TASK_COUNT] = {"Threshold", "Caffe", "Darknet"};
+
+void visionSchedulerInitialize(VISION_SCHEDULER *scheduler, float budgetMilliseconds)
+{
+	scheduler->budget = budgetMilliseconds;
+	scheduler->network = VISION_TASK_DARKNET;
+	scheduler->controlDemand = false;
+	for(int i = 0; i < VISION_TASK_COUNT; i++) scheduler->latency[i] = 0;
+	visionSchedulerReset(scheduler);
+}
+
+void visionSchedulerReset(VISION_SCHEDULER *scheduler)
+{
+	scheduler->credit = 0;
+	scheduler->decision = 0;
+	scheduler->used = 0;
+	scheduler->slack = 0;
+	scheduler->consumption = 0;
+	scheduler->frames = 0;
+	scheduler->overruns = 0;
+	scheduler->totalSlack = 0;
+	for(int i = 0; i < VISION_TASK_COUNT; i++) scheduler->runs[i] = 0;
+}
+
+uint32_t visionSchedulerDecide(VISION_SCHEDULER *scheduler, bool networkReady)
+{
+	const float network = scheduler->latency[scheduler->network];
+
+	scheduler->decision = VISION_TASK_BIT(VISION_TASK_THRESHOLD);
+	if(networkReady && !scheduler->controlDemand &&
+		(network == 0 || scheduler->credit + scheduler->budget >= scheduler->latency[VISION_TASK_THRESHOLD] + network))
+	{
+		scheduler->decision |= VISION_TASK_BIT(scheduler->network);
+	}
+	return scheduler->decision;
+}
+
+void visionSchedulerRecord(VISION_SCHEDULER *scheduler, VISION_TASK task, float milliseconds)
+{
+	float *latency = &(scheduler->latency[task]);
+
+	*latency = (*latency == 0) ? milliseconds : *latency + VISION_SCHEDULER_AVERAGE_WEIGHT * (milliseconds - *latency);
+	scheduler->runs[task]++;
+}
+
+void visionSchedulerFinish(VISION_SCHEDULER *scheduler, float milliseconds)
+{
+	scheduler->used = milliseconds;
+	scheduler->slack = scheduler->budget - milliseconds;
+	scheduler->credit = min(scheduler->credit + scheduler->slack, scheduler->latency[scheduler->network]);
+	scheduler->consumption = (scheduler->frames == 0) ? milliseconds : scheduler->consumption + VISION_SCHEDULER_AVERAGE_WEIGHT * (milliseconds - scheduler->consumption);
+	scheduler->frames++;
+	scheduler->totalSlack += scheduler->slack;
+	if(scheduler->slack < 0) scheduler->overruns++;
+}
+
+float visionSchedulerCaptureInterval(const VISION_SCHEDULER *scheduler)
+{
+	return scheduler->consumption * VISION_SCHEDULER_CAPTURE_MARGIN;
+}
+
+void visionSchedulerReport(const VISION_SCHEDULER *scheduler)
+{
+	if(scheduler->frames == 0) return;
+
+	printf("Scheduler: %llu frames at %.1f ms budget, average slack %.1f ms, %llu over budget\n",
+			(unsigned long long)scheduler->frames,
+			scheduler->budget,
+			scheduler->totalSlack / scheduler->frames,
+			(unsigned long long)scheduler->overruns);
+	for(int i = 0; i < VISION_TASK_COUNT; i++)
+	{
+		if(scheduler->latency[i] == 0) continue;
+		printf("Scheduler: %s ran %llu times, averaging %.1f ms\n",
+				visionSchedulerTaskNames[i],
+				(unsigned long long)scheduler->runs[i],
+				scheduler->latency[i]);
+	}
+}
@@ -0,0 +1,132 @@
+/** @file visionScheduler.hpp
+ *  @brief Function prototypes for choosing what processing runs on each frame.
+ *
+ *  These are the prototypes for functions that keep a moving average of how long each
+ *  kind of processing takes on this board, and given a per-frame time budget decide
+ *  frame by frame what to run. Thresholding is cheap and runs every frame. A network
+ *  costs several frames' worth of budget, so the time thresholding leaves unused is
+ *  banked each frame and the network runs whenever the bank plus this frame's budget
+ *  covers it; the average frame then stays within budget, and the network ends up
+ *  running every Nth frame, with N set by the measured costs rather than by hand. When
+ *  the control loop needs the processor (it is tracking a target) the network is left
+ *  out altogether. Every decision, and the slack it left, is counted for reporting.
+ *  The average processing time per frame also tells PRU1's capture governor how often
+ *  frames are worth capturing.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONSCHEDULER_HPP_
+#define VISIONSCHEDULER_HPP_
+
+#include <stdint.h>
+
+#define VISION_SCHEDULER_DEFAULT_BUDGET_MS	40.0f
+#define VISION_SCHEDULER_AVERAGE_WEIGHT		0.2f
+#define VISION_SCHEDULER_CAPTURE_MARGIN		0.9f
+
+typedef enum{
+	VISION_TASK_THRESHOLD,
+	VISION_TASK_CAFFE,
+	VISION_TASK_DARKNET,
+	VISION_TASK_COUNT
+} VISION_TASK;
+
+#define VISION_TASK_BIT(task)				(1u << (task))
+
+typedef struct{
+	float budget;
+	VISION_TASK network;
+	bool controlDemand;
+	float latency[VISION_TASK_COUNT];
+	float credit;
+	uint32_t decision;
+	float used;
+	float slack;
+	float consumption;
+	uint64_t frames;
+	uint64_t overruns;
+	uint64_t runs[VISION_TASK_COUNT];
+	double totalSlack;
+} VISION_SCHEDULER;
+
+/** @brief Sets up a scheduler
+ *
+ *	@param	scheduler the scheduler to initialize.
+ *	@param	budgetMilliseconds the processing time allowed per frame, on average.
+ * 	@return void.
+ *
+ */
+void visionSchedulerInitialize(VISION_SCHEDULER *scheduler, float budgetMilliseconds);
+
+/** @brief Forgets the banked time and the counters, but keeps the measured latencies
+ *
+ *	@param	scheduler the scheduler.
+ * 	@return void.
+ *
+ */
+void visionSchedulerReset(VISION_SCHEDULER *scheduler);
+
+/** @brief Decides what to run on this frame
+ *
+ * 	Thresholding is always chosen. The network is chosen as well if it is ready, the
+ * 	control loop isn't asking for the time, and either its cost hasn't been measured
+ * 	yet or the banked time plus this frame's budget covers both.
+ *
+ *	@param	scheduler the scheduler.
+ *	@param	networkReady whether the network's model is loaded.
+ * 	@return the chosen tasks, as VISION_TASK_BIT flags.
+ *
+ */
+uint32_t visionSchedulerDecide(VISION_SCHEDULER *scheduler, bool networkReady);
+
+/** @brief Folds a measured run time into a task's moving average
+ *
+ * 	Called whenever a task runs, scheduled or not, so the costs are known before the
+ * 	scheduler is first used.
+ *
+ *	@param	scheduler the scheduler.
+ *	@param	task the task that ran.
+ *	@param	milliseconds how long it took.
+ * 	@return void.
+ *
+ */
+void visionSchedulerRecord(VISION_SCHEDULER *scheduler, VISION_TASK task, float milliseconds);
+
+/** @brief Closes a scheduled frame
+ *
+ * 	Works out the frame's slack (budget less the time used, negative when over), banks
+ * 	it (never more than one network run's worth), and updates the counters.
+ *
+ *	@param	scheduler the scheduler.
+ *	@param	milliseconds the processing time the frame actually used.
+ * 	@return void.
+ *
+ */
+void visionSchedulerFinish(VISION_SCHEDULER *scheduler, float milliseconds);
+
+/** @brief Works out how often frames need capturing to keep up with what is run on them
+ *
+ * 	That is the moving average of the processing time scheduled frames have used,
+ * 	less a margin (VISION_SCHEDULER_CAPTURE_MARGIN of it is returned) so the next frame
+ * 	is in a little before it is wanted rather than a little after.
+ *
+ *	@param	scheduler the scheduler.
+ * 	@return the capture interval in milliseconds, 0 until a frame has been finished.
+ *
+ */
+float visionSchedulerCaptureInterval(const VISION_SCHEDULER *scheduler);
+
+/** @brief Prints what the scheduler did
+ *
+ *	@param	scheduler the scheduler.
+ * 	@return void.
+ *
+ */
+void visionSchedulerReport(const VISION_SCHEDULER *scheduler);
+
+#endif /* VISIONSCHEDULER_HPP_ */
@@ -0,0 +1,179 @@
+/** @file visionTracker.cpp
+ *  @brief Functions for tracking targets and predicting where they will be.
+ *
+ *  Per axis the state is [position, velocity] with covariance [[p, c], [c, v]]. The
+ *  prediction over dt uses the usual white noise acceleration process noise, and the
+ *  update is the scalar measurement case written out, so no matrices are involved.
+ *  Association is greedy nearest neighbour, which is fine for the one or two targets
+ *  we see at a time.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#include "visionTracker.hpp"
+
+using namespace cv;
+
+static void visionTrackerAxisStart(VISION_TRACKER_AXIS *axis, float position)
+{
+	axis->position = position;
+	axis->velocity = 0;
+	axis->positionVariance = VISION_TRACKER_MEASUREMENT_NOISE;
+	axis->covariance = 0;
+	axis->velocityVariance = VISION_TRACKER_INITIAL_VELOCITY_VARIANCE;
+}
+
+static void visionTrackerAxisPredict(VISION_TRACKER_AXIS *axis, float dt)
+{
+	const float q = VISION_TRACKER_PROCESS_NOISE;
+
+	axis->position += axis->velocity * dt;
+	axis->positionVariance += dt * (2 * axis->covariance + dt * axis->velocityVariance) + q * dt * dt * dt / 3;
+	axis->covariance += dt * axis->velocityVariance + q * dt * dt / 2;
+	axis->velocityVariance += q * dt;
+}
+
+static void visionTrackerAxisUpdate(VISION_TRACKER_AXIS *axis, float measurement)
+{
+	const float innovationVariance = axis->positionVariance + VISION_TRACKER_MEASUREMENT_NOISE;
+	const float positionGain = axis->positionVariance / innovationVariance;
+	const float velocityGain = axis->covariance / innovationVariance;
+	const float innovation = measurement - axis->position;
+
+	axis->position += positionGain * innovation;
+	axis->velocity += velocityGain * innovation;
+	axis->velocityVariance -= velocityGain * axis->covariance;
+	axis->positionVariance -= positionGain * axis->positionVariance;
+	axis->covariance -= positionGain * axis->covariance;
+}
+
+static void visionTrackerStart(VISION_TRACKER *tracker, uint64_t timestamp, Point2f center, int classId)
+{
+	int slot = tracker->count;
+
+	if(tracker->count == VISION_TRACKER_MAX_TARGETS)
+	{
+		slot = 0;
+		for(int i = 1; i < tracker->count; i++)
+		{
+			if(tracker->targets[i].lastSeen < tracker->targets[slot].lastSeen) slot = i;
+		}
+	}
+	else
+	{
+		tracker->count++;
+	}
+
+	VISION_TRACKER_TARGET *target = &(tracker->targets[slot]);
+	target->id = tracker->nextId++;
+	target->classId = classId;
+	target->hits = 1;
+	target->timestamp = timestamp;
+	target->lastSeen = timestamp;
+	target->measured = center;
+	visionTrackerAxisStart(&(target->x), center.x);
+	visionTrackerAxisStart(&(target->y), center.y);
+}
+
+void visionTrackerReset(VISION_TRACKER *tracker)
+{
+	tracker->count = 0;
+	tracker->nextId = 0;
+}
+
+void visionTrackerUpdate(VISION_TRACKER *tracker, uint64_t timestamp, const Point2f *centers, const int *classIds, int count)
+{
+	bool matched[VISION_TRACKER_MAX_TARGETS] = {false};
+	const int existing = tracker->count;
+
+	for(int i = 0; i < existing; i++)
+	{
+		VISION_TRACKER_TARGET *target = &(tracker->targets[i]);
+		if(timestamp <= target->timestamp) continue;
+		float dt = (timestamp - target->timestamp) / 1e9f;
+		visionTrackerAxisPredict(&(target->x), dt);
+		visionTrackerAxisPredict(&(target->y), dt);
+		target->timestamp = timestamp;
+	}
+
+	for(int m = 0; m < count; m++)
+	{
+		int best = -1;
+		float bestDistance = VISION_TRACKER_GATE_PIXELS * VISION_TRACKER_GATE_PIXELS;
+
+		for(int i = 0; i < existing; i++)
+		{
+			const VISION_TRACKER_TARGET *target = &(tracker->targets[i]);
+			if(matched[i] || target->classId != classIds[m]) continue;
+
+			float dx = centers[m].x - target->x.position;
+			float dy = centers[m].y - target->y.position;
+			if(dx * dx + dy * dy < bestDistance)
+			{
+				bestDistance = dx * dx + dy * dy;
+				best = i;
+			}
+		}
+
+		if(best < 0)
+		{
+			visionTrackerStart(tracker, timestamp, centers[m], classIds[m]);
+			continue;
+		}
+
+		VISION_TRACKER_TARGET *target = &(tracker->targets[best]);
+		visionTrackerAxisUpdate(&(target->x), centers[m].x);
+		visionTrackerAxisUpdate(&(target->y), centers[m].y);
+		target->lastSeen = timestamp;
+		target->measured = centers[m];
+		target->hits++;
+		matched[best] = true;
+	}
+
+	for(int i = 0; i < tracker->count; )
+	{
+		if(timestamp - tracker->targets[i].lastSeen > VISION_TRACKER_TIMEOUT_NS)
+		{
+			tracker->targets[i] = tracker->targets[--tracker->count];
+			continue;
+		}
+		i++;
+	}
+}
+
+void visionTrackerUpdateDetections(VISION_TRACKER *tracker, uint64_t timestamp, const VISION_DETECTIONS *detections)
+{
+	Point2f centers[VISION_DETECTIONS_MAX];
+	int classIds[VISION_DETECTIONS_MAX];
+
+	for(int i = 0; i < detections->keptCount; i++)
+	{
+		const Rect &box = detections->box[detections->kept[i]];
+		centers[i] = Point2f(box.x + box.width * 0.5f, box.y + box.height * 0.5f);
+		classIds[i] = detections->classId[detections->kept[i]];
+	}
+	visionTrackerUpdate(tracker, timestamp, centers, classIds, detections->keptCount);
+}
+
+int visionTrackerPrimary(const VISION_TRACKER *tracker)
+{
+	int primary = -1;
+
+	for(int i = 0; i < tracker->count; i++)
+	{
+		if(primary < 0 || tracker->targets[i].hits > tracker->targets[primary].hits) primary = i;
+	}
+	return primary;
+}
+
+Point2f visionTrackerPredict(const VISION_TRACKER *tracker, int index, uint64_t time)
+{
+	const VISION_TRACKER_TARGET *target = &(tracker->targets[index]);
+	float dt = (time > target->timestamp) ? (time - target->timestamp) / 1e9f : 0;
+
+	return Point2f(target->x.position + target->x.velocity * dt, target->y.position + target->y.velocity * dt);
+}
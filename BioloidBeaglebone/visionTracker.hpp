@@ -0,0 +1,120 @@
+/** @file visionTracker.hpp
+ *  @brief Function prototypes for tracking targets and predicting where they will be.
+ *
+ *  These are the prototypes for functions that keep a constant velocity Kalman filter
+ *  per target, fed with the centroids the vision modes find and stamped with the time
+ *  the frame was captured, and that predict where a target will be at any later time.
+ *  By the time anything reacts to a detection, the frame it came from is the capture,
+ *  handoff, inference and command latency old; asking for the position at 'now plus
+ *  that latency' gives a smooth target that is where the target actually is, and can
+ *  be asked for as often as the controller runs rather than once per detection.
+ *
+ *  Each axis is filtered separately (the constant velocity model doesn't couple them),
+ *  so the filter is a few multiply/adds on two 2x2 covariances per target per update,
+ *  with nothing allocated.
+ *
+ *  @author Bill Merryman
+ *  @bug No known bugs.
+ *
+ *  Created on: Oct 19, 2026
+ *
+ */
+
+#ifndef VISIONTRACKER_HPP_
+#define VISIONTRACKER_HPP_
+
+#include <stdint.h>
+#include "opencv2/core.hpp"
+#include "visionDetections.hpp"
+
+#define VISION_TRACKER_MAX_TARGETS			8
+#define VISION_TRACKER_GATE_PIXELS			60.0f
+#define VISION_TRACKER_TIMEOUT_NS			1000000000ull
+#define VISION_TRACKER_MEASUREMENT_NOISE	4.0f		/* pixels squared */
+#define VISION_TRACKER_PROCESS_NOISE		20000.0f	/* pixels squared per second cubed */
+#define VISION_TRACKER_INITIAL_VELOCITY_VARIANCE	40000.0f
+#define VISION_TRACKER_THRESHOLD_CLASS		-1
+
+typedef struct{
+	float position;
+	float velocity;
+	float positionVariance;
+	float covariance;
+	float velocityVariance;
+} VISION_TRACKER_AXIS;
+
+typedef struct{
+	int id;
+	int classId;
+	int hits;
+	uint64_t timestamp;
+	uint64_t lastSeen;
+	cv::Point2f measured;		/* the centre as last measured, before filtering */
+	VISION_TRACKER_AXIS x;
+	VISION_TRACKER_AXIS y;
+} VISION_TRACKER_TARGET;
+
+typedef struct{
+	VISION_TRACKER_TARGET targets[VISION_TRACKER_MAX_TARGETS];
+	int count;
+	int nextId;
+} VISION_TRACKER;
+
+/** @brief Empties a tracker
+ *
+ *	@param	tracker the tracker to reset.
+ * 	@return void.
+ *
+ */
+void visionTrackerReset(VISION_TRACKER *tracker);
+
+/** @brief Feeds a frame's measurements to the tracker
+ *
+ * 	Every target is first predicted forward to the frame's timestamp. Then each
+ * 	measurement updates the nearest target of the same class within
+ * 	VISION_TRACKER_GATE_PIXELS of its prediction, or starts a new target if there is
+ * 	none (replacing the longest unseen target if the tracker is full). Targets not seen
+ * 	for VISION_TRACKER_TIMEOUT_NS are dropped.
+ *
+ *	@param	tracker the tracker.
+ *	@param	timestamp when the frame was captured, from frameRecordingNow.
+ *	@param	centers the measured target centres, in frame pixels.
+ *	@param	classIds the class of each measurement.
+ *	@param	count the number of measurements.
+ * 	@return void.
+ *
+ */
+void visionTrackerUpdate(VISION_TRACKER *tracker, uint64_t timestamp, const cv::Point2f *centers, const int *classIds, int count);
+
+/** @brief Feeds the centres of a frame's kept detections to the tracker
+ *
+ *	@param	tracker the tracker.
+ *	@param	timestamp when the frame was captured.
+ *	@param	detections the frame's detections, boxes in frame coordinates.
+ * 	@return void.
+ *
+ */
+void visionTrackerUpdateDetections(VISION_TRACKER *tracker, uint64_t timestamp, const VISION_DETECTIONS *detections);
+
+/** @brief Picks the target worth following
+ *
+ *	@param	tracker the tracker.
+ * 	@return the index of the target that has been seen most often, or -1 if there are none.
+ *
+ */
+int visionTrackerPrimary(const VISION_TRACKER *tracker);
+
+/** @brief Predicts where a target will be
+ *
+ * 	Extrapolates the target's filtered position and velocity; the tracker itself is not
+ * 	changed, so this can be called as often as wanted between updates.
+ *
+ *	@param	tracker the tracker.
+ *	@param	index the target's index.
+ *	@param	time the time to predict for, on the same clock as the frame timestamps.
+ * 	@return the predicted position in frame pixels.
+ *
+ */
+cv::Point2f visionTrackerPredict(const VISION_TRACKER *tracker, int index, uint64_t time);
+
+#endif /* VISIONTRACKER_HPP_ */